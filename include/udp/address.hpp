@@ -0,0 +1,73 @@
+
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+namespace udp {
+
+enum class AddressFamily : uint8_t {
+    V4,    // AF_INET only
+    V6,    // AF_INET6 with IPV6_V6ONLY
+    Dual   // AF_INET6 accepting IPv4 as v4-mapped addresses
+};
+
+// Compact socket address large enough for IPv4 and IPv6 (28 bytes, vs 128 for
+// sockaddr_storage) so per-packet metadata stays small.
+struct SockAddr {
+    union {
+        sockaddr sa;
+        sockaddr_in v4;
+        sockaddr_in6 v6;
+    };
+    socklen_t len;
+
+    SockAddr() : v6{}, len(0) {}
+    int family() const { return len ? sa.sa_family : AF_UNSPEC; }
+    uint16_t port() const;
+};
+
+// Parses a numeric IPv4 or IPv6 literal. Returns false on malformed input.
+bool parse_address(const std::string& ip, uint16_t port, SockAddr& out);
+// Rewrites an IPv4 address as ::ffff:a.b.c.d so it can be used on an AF_INET6 socket.
+SockAddr to_v4_mapped(const SockAddr& a);
+std::string to_string(const SockAddr& a);
+
+// Client identity: the full 128-bit address plus port. IPv4 sources are
+// stored v4-mapped so v4 and dual-stack sockets produce the same key.
+struct ClientKey {
+    uint64_t addr_hi;
+    uint64_t addr_lo;
+    uint16_t port;
+    bool operator==(const ClientKey& o) const {
+        return addr_hi==o.addr_hi && addr_lo==o.addr_lo && port==o.port;
+    }
+};
+
+ClientKey make_client_key(const SockAddr& a);
+// IPv4 address and port in host byte order.
+ClientKey make_client_key(uint32_t addr, uint16_t port);
+
+inline uint64_t mix64(uint64_t x) {
+    x ^= x >> 32;
+    x *= 0xD6E8FEB86659FD93ull;
+    x ^= x >> 32;
+    return x;
+}
+
+// Address-only fingerprint (port ignored); never zero so it can tag empty slots.
+inline uint64_t addr_hash(const ClientKey& k) {
+    uint64_t h = mix64(k.addr_hi ^ (k.addr_lo * 0x9E3779B97F4A7C15ull));
+    return h ? h : 1;
+}
+
+struct ClientKeyHash {
+    size_t operator()(const ClientKey& k) const {
+        return static_cast<size_t>(mix64(k.addr_hi ^ (k.addr_lo * 0x9E3779B97F4A7C15ull) ^ k.port));
+    }
+};
+
+} // namespace udp
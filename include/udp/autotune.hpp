@@ -0,0 +1,56 @@
+
+#pragma once
+#include <cstdint>
+#include <cstddef>
+
+namespace udp {
+
+struct AutotuneConfig {
+    bool enabled = false;
+    int min_batch = 8;
+    int max_batch = 1024;
+    uint64_t latency_target_ns = 0;  // max time to service one batch, 0 = no target
+    int max_rcvbuf = 64 << 20;       // ceiling for SO_RCVBUF growth (bytes)
+    uint64_t interval_ns = 100'000'000;
+};
+
+// Grows or shrinks the recvmmsg batch from observed fill ratios and batch
+// service time, and asks for a larger receive buffer when the kernel reports
+// overflow drops. Decisions are made once per interval from counters
+// accumulated by on_batch(), so the per-batch cost is a few adds.
+class BatchTuner {
+public:
+    struct Decision {
+        int batch = 0;
+        bool evaluated = false;  // a window closed on this tick
+        bool grew = false;
+        bool shrank = false;
+        bool raise_rcvbuf = false;
+    };
+
+    BatchTuner(const AutotuneConfig& cfg, int initial_batch);
+
+    void on_batch(size_t filled, uint64_t service_ns) {
+        ++batches_;
+        filled_ += filled;
+        service_ns_ += service_ns;
+    }
+    // Evaluates the window ending at now_ns. `kernel_drops` is the socket's
+    // cumulative overflow counter.
+    Decision tick(uint64_t now_ns, uint64_t kernel_drops);
+
+    int batch() const { return batch_; }
+    double last_fill_ratio() const { return last_fill_; }
+    // Next SO_RCVBUF size to request, doubling from `current` up to the ceiling.
+    int next_rcvbuf(int current) const;
+
+private:
+    AutotuneConfig cfg_;
+    int batch_;
+    uint64_t window_start_{0};
+    uint64_t batches_{0}, filled_{0}, service_ns_{0};
+    uint64_t last_drops_{0};
+    double last_fill_{0.0};
+};
+
+} // namespace udp
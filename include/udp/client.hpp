@@ -17,8 +17,33 @@ struct ClientConfig {
     int seconds = 5;
     int payload = 64;
     int batch = 64;
+    int sndbuf = 1 << 20;
+    int rcvbuf = 1 << 20;        // SO_RCVBUF request for the echo stream (RTT mode)
     int id = 0;
     bool verbose = false;
+    bool tx_timestamps = false;  // kernel software TX timestamps -> TxStack latency
+    bool rtt = false;            // read echoes back and measure round-trip time
+    int rtt_drain_ms = 1000;     // after sending, wait this long for outstanding echoes
+};
+
+// End-of-run RTT mode result. An echo counts once; repeats are duplicates,
+// and echoes older than the outstanding ring (or of unknown seq) are late.
+// A late echo did come back, it just could not be timed, so it is not lost;
+// neither is one the kernel dropped from this client's own receive queue.
+struct RttReport {
+    uint64_t sent = 0;
+    uint64_t received = 0;     // distinct echoes matched to an outstanding packet
+    uint64_t duplicates = 0;
+    uint64_t late = 0;
+    uint64_t client_rx_dropped = 0;  // echoes dropped on this client's full SO_RCVBUF
+    double send_seconds = 0;   // time spent in the send loop
+    // Path loss: packets or echoes lost between the two sockets.
+    uint64_t lost() const {
+        const uint64_t accounted = received + late + client_rx_dropped;
+        return sent > accounted ? sent - accounted : 0;
+    }
+    double loss_ratio() const { return sent ? static_cast<double>(lost()) / sent : 0.0; }
+    double achieved_pps() const { return send_seconds > 0 ? sent / send_seconds : 0.0; }
 };
 
 class UdpClient {
@@ -29,14 +54,47 @@ public:
     void stop();
     void join();
     const Stats& stats() const { return stats_; }
+    // Valid once join() returns in RTT mode.
+    RttReport rtt_report() const;
 private:
     void run_loop();
+    void recv_loop();
+    void collect_tx_timestamps();
+    void drain_echoes();
+    static constexpr size_t kTxRing = 4096;
+    // Outstanding packets in RTT mode, indexed by seq % kRttRing. A slot holds
+    // the seq it was armed for and its send time. The sender rearms it as a
+    // seqlock (seq=0, time, then seq); the receiver claims it by CAS-ing seq
+    // to seq|kRttClaimed, reads the time, and re-checks seq, so a slot lapped
+    // mid-claim is reported late instead of yielding a bogus RTT.
+    static constexpr size_t kRttRing = 1 << 16;
+    static constexpr uint64_t kRttClaimed = uint64_t(1) << 63;
+    // Receiver-private record of the last seq answered per index, wider than
+    // the outstanding ring: a repeat is a duplicate even when its slot has
+    // since been rearmed, so late echoes are never counted twice.
+    static constexpr size_t kRttSeen = kRttRing * 4;
+    struct Outstanding {
+        std::atomic<uint64_t> seq{0};
+        std::atomic<uint64_t> sent_ns{0};
+    };
     std::unique_ptr<ISocket> sock_;
     ClientConfig cfg_;
     Stats stats_;
     std::thread th_;
     std::atomic<bool> running_{false};
     uint64_t seq_{0};
+    bool tx_ts_enabled_{false};
+    uint32_t tx_id_{0};                       // kernel OPT_ID of the next datagram
+    // User-space send stamp by id % kTxRing, written before the send. In RTT
+    // mode the receive thread drains the error queue, so it reads these too.
+    std::unique_ptr<std::atomic<uint64_t>[]> tx_sent_ns_;
+    std::vector<TxTimestamp> tx_ts_buf_;      // owned by whichever thread drains
+    std::unique_ptr<Outstanding[]> outstanding_;
+    std::vector<uint64_t> rtt_seen_;
+    std::thread rx_th_;
+    std::atomic<bool> rx_running_{false};
+    std::atomic<uint64_t> rtt_matched_{0}, rtt_dups_{0}, rtt_late_{0};
+    double send_seconds_{0};
 };
 
 } // namespace udp
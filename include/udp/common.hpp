@@ -4,13 +4,14 @@
 #include <cstddef>
 #include <string>
 #include <chrono>
+#include <ctime>
 
 namespace udp {
 
 #pragma pack(push, 1)
 struct PacketHeader {
     uint64_t seq;         // sequence number
-    uint64_t send_ts_ns;  // sender timestamp (ns)
+    uint64_t send_ts_ns;  // sender wall-clock timestamp (ns, CLOCK_REALTIME)
     uint32_t magic;       // magic for sanity
 };
 #pragma pack(pop)
@@ -22,6 +23,14 @@ inline uint64_t now_ns() {
     return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
 }
 
+// CLOCK_REALTIME in ns: the clock domain of kernel SO_TIMESTAMPING stamps and of
+// PacketHeader::send_ts_ns, so it is comparable across (synchronised) hosts.
+inline uint64_t wall_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1'000'000'000ull + static_cast<uint64_t>(ts.tv_nsec);
+}
+
 inline std::string human_rate(double v) {
     char buf[64];
     if (v > 1e6) snprintf(buf, sizeof(buf), "%.2f Mpps", v / 1e6);
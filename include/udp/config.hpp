@@ -0,0 +1,29 @@
+
+#pragma once
+#include <string>
+#include <vector>
+#include "udp/server.hpp"
+
+namespace udp {
+
+// Server options share one vocabulary between the command line ("--batch 64")
+// and config files ("batch = 64" or "batch 64", one per line, '#' comments).
+
+// True if `name` (without leading dashes) is a known option that takes a value.
+bool server_option_takes_value(const std::string& name);
+// Applies one option. Returns false if unknown; throws std::runtime_error for
+// a malformed or out-of-range value. A flag is set by an empty value, "1" or
+// "true" and cleared by "0" or "false".
+bool apply_server_option(ServerConfig& cfg, const std::string& name, const std::string& value);
+// Loads a config file on top of `cfg`. Unknown options, a missing or invalid
+// value, or more than one value are errors: returns false and sets `err`.
+bool load_server_config(const std::string& path, ServerConfig& cfg, std::string& err);
+// The option's current value in `cfg`, as apply_server_option would take it
+// ("1"/"0" for flags); empty for unknown names.
+std::string server_option_value(const ServerConfig& cfg, const std::string& name);
+// Copies the options UdpServer::reconfigure() can apply at runtime (workers,
+// batch) from `loaded` into `running`. Every other option whose value differs
+// is left alone in `running` and its name returned: it needs a restart.
+std::vector<std::string> apply_reloadable(ServerConfig& running, const ServerConfig& loaded);
+
+} // namespace udp
@@ -0,0 +1,53 @@
+
+#pragma once
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstddef>
+
+namespace udp {
+
+// Lock-free HyperLogLog estimate of how many distinct keys were ever added.
+// 4096 one-byte registers give ~1.6% standard error in 4 KiB no matter how
+// many keys arrive. Below ~10k keys linear counting is used instead: its
+// error is smaller (about 1% around a thousand keys) but the result is still
+// an estimate, not an exact count. add() is idempotent, so callers may add a key
+// again whenever convenient (e.g. each time its flow is re-created).
+class DistinctCounter {
+public:
+    static constexpr int kBits = 12;
+    static constexpr size_t kRegisters = size_t(1) << kBits;
+
+    void add(uint64_t hash) {
+        // Re-mix so weak input hashes still spread over registers and ranks.
+        uint64_t h = hash + 0x9E3779B97F4A7C15ull;
+        h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ull;
+        h = (h ^ (h >> 27)) * 0x94D049BB133111EBull;
+        h ^= h >> 31;
+        const size_t idx = static_cast<size_t>(h >> (64 - kBits));
+        const uint64_t rest = (h << kBits) | (uint64_t(1) << (kBits - 1));
+        const uint8_t rank = static_cast<uint8_t>(__builtin_clzll(rest) + 1);
+        uint8_t cur = regs_[idx].load(std::memory_order_relaxed);
+        while (rank > cur && !regs_[idx].compare_exchange_weak(cur, rank, std::memory_order_relaxed)) {
+        }
+    }
+
+    uint64_t estimate() const {
+        const double m = static_cast<double>(kRegisters);
+        double sum = 0;
+        size_t zeros = 0;
+        for (const auto& r : regs_) {
+            const uint8_t v = r.load(std::memory_order_relaxed);
+            sum += std::ldexp(1.0, -v);
+            zeros += v == 0;
+        }
+        double e = 0.7213 / (1.0 + 1.079 / m) * m * m / sum;
+        if (e <= 2.5 * m && zeros) e = m * std::log(m / static_cast<double>(zeros));
+        return static_cast<uint64_t>(e + 0.5);
+    }
+
+private:
+    std::atomic<uint8_t> regs_[kRegisters]{};
+};
+
+} // namespace udp
@@ -0,0 +1,76 @@
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "udp/address.hpp"
+#include "udp/stats.hpp"
+#include "udp/timer_wheel.hpp"
+
+namespace udp {
+
+struct FlowConfig {
+    size_t capacity = 1 << 16;              // tracked flows per table
+    uint64_t idle_timeout_ns = 30'000'000'000ull;
+    uint64_t tick_ns = 10'000'000;          // timer wheel resolution
+};
+
+// Per-flow state. Sequence numbers feed a 64-packet loss window: `seq_mask`
+// bit i stands for seq `max_seq - i`. A gap is only counted as lost once it
+// slides out of the window, so reordering within 64 packets is not loss.
+struct FlowState {
+    ClientKey key{};
+    uint64_t first_seen_ns = 0;
+    uint64_t last_seen_ns = 0;
+    uint64_t packets = 0;
+    uint64_t bytes = 0;
+    uint64_t window_start_ns = 0;  // current one-second rate window
+    uint32_t window_packets = 0;
+    uint32_t pps = 0;              // packets in the last complete window
+    uint64_t max_seq = 0;
+    uint64_t seq_mask = 0;
+    uint64_t lost = 0;
+    uint64_t reordered = 0;
+    uint64_t duplicates = 0;
+};
+
+// Bounded flow table for one worker. Flows live in a fixed pool indexed by an
+// open-addressed hash; the pool index doubles as the flow's timer id. Packets
+// only touch last_seen_ns; when a flow's idle timer fires it is either
+// re-armed from last_seen_ns or expired, so the hot path never relinks timers.
+// When the pool is full new flows are not tracked and are counted as rejected.
+//
+// Not thread-safe: one table per receive (or processing) thread. Totals go to
+// the shared, atomic FlowCounters when `counters` is non-null.
+class FlowTable {
+public:
+    FlowTable(const FlowConfig& cfg, uint64_t now_ns, FlowCounters* counters);
+
+    // Accounts one packet; `seq` 0 means "no sequence number". Returns the
+    // flow, or nullptr when the table is full and the flow is new.
+    FlowState* observe(const ClientKey& k, uint32_t bytes, uint64_t seq, uint64_t now_ns);
+    // Runs the timer wheel up to `now_ns`; returns flows expired.
+    size_t expire(uint64_t now_ns);
+    // Forgets all flows, e.g. when the owning worker is retired.
+    void clear();
+
+    const FlowState* find(const ClientKey& k) const;
+    size_t active() const { return active_; }
+    size_t capacity() const { return pool_.size(); }
+private:
+    static constexpr uint32_t kEmpty = ~0u;
+    size_t probe_start(const ClientKey& k) const { return ClientKeyHash{}(k) & index_mask_; }
+    void release(uint32_t id);
+    void track_seq(FlowState& f, uint64_t seq);
+
+    FlowConfig cfg_;
+    std::vector<FlowState> pool_;
+    std::vector<uint32_t> free_;
+    std::vector<uint32_t> index_;  // open-addressed, pool ids
+    size_t index_mask_;
+    TimerWheel wheel_;
+    size_t active_{0};
+    FlowCounters* counters_;
+};
+
+} // namespace udp
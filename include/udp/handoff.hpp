@@ -0,0 +1,49 @@
+
+#pragma once
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace udp {
+
+// Zero-downtime restart: the running process listens on a Unix socket and
+// passes its bound UDP fds (SCM_RIGHTS) to a successor that connects. Both
+// processes then share the same kernel socket, so nothing queued is lost; the
+// old process stops reading once the successor acknowledges it is serving.
+//
+// Wire protocol: on connect the server sends a header ('N' and the fd count
+// as a uint32), then one byte with the fds attached, then waits for a single
+// ack byte from the client.
+class HandoffServer {
+public:
+    HandoffServer(std::string path, std::vector<int> fds);
+    ~HandoffServer();
+    void start();
+    void stop();
+    // True once a successor has received the fds and acknowledged.
+    bool handed_off() const { return handed_off_.load(); }
+private:
+    void run();
+    std::string path_;
+    std::vector<int> fds_;
+    int listen_fd_{-1};
+    std::thread th_;
+    std::atomic<bool> running_{false};
+    std::atomic<bool> handed_off_{false};
+};
+
+class HandoffClient {
+public:
+    explicit HandoffClient(const std::string& path);
+    ~HandoffClient();
+    // Receives the predecessor's fds; throws std::runtime_error on failure,
+    // including when fewer fds arrive than the predecessor announced.
+    std::vector<int> receive();
+    // Tells the predecessor it can stop reading.
+    void ack();
+private:
+    int fd_{-1};
+};
+
+} // namespace udp
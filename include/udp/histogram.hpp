@@ -0,0 +1,72 @@
+
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+namespace udp {
+
+// Lock-free log-linear histogram of nanosecond values. Each power-of-two
+// octave is split into 8 linear sub-buckets (~12% relative error), so the
+// whole 64-bit range fits in 496 counters and record() is a couple of
+// relaxed atomic adds.
+class LatencyHistogram {
+public:
+    static constexpr int kSubBits = 3;
+    static constexpr uint64_t kSub = 1u << kSubBits;
+    static constexpr size_t kBuckets = (64 - kSubBits + 1) * kSub;
+
+    // Records `n` samples of value v, e.g. one per packet of a batch that
+    // all saw the same latency.
+    void record(uint64_t v, uint64_t n = 1) {
+        counts_[index(v)].fetch_add(n, std::memory_order_relaxed);
+        count_.fetch_add(n, std::memory_order_relaxed);
+        sum_.fetch_add(v * n, std::memory_order_relaxed);
+    }
+
+    uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+    uint64_t sum() const { return sum_.load(std::memory_order_relaxed); }
+
+    // Upper bound of the bucket holding the q-quantile (0 <= q <= 1); 0 if empty.
+    uint64_t percentile(double q) const {
+        uint64_t total = 0;
+        for (auto& c : counts_) total += c.load(std::memory_order_relaxed);
+        if (total == 0) return 0;
+        uint64_t target = static_cast<uint64_t>(q * static_cast<double>(total) + 0.5);
+        if (target == 0) target = 1;
+        uint64_t seen = 0;
+        for (size_t i = 0; i < kBuckets; ++i) {
+            seen += counts_[i].load(std::memory_order_relaxed);
+            if (seen >= target) return upper_bound(i);
+        }
+        return upper_bound(kBuckets - 1);
+    }
+
+    void reset() {
+        for (auto& c : counts_) c.store(0, std::memory_order_relaxed);
+        count_.store(0, std::memory_order_relaxed);
+        sum_.store(0, std::memory_order_relaxed);
+    }
+
+    static size_t index(uint64_t v) {
+        if (v < kSub) return static_cast<size_t>(v);
+        int msb = 63 - __builtin_clzll(v);
+        return static_cast<size_t>(msb - kSubBits + 1) * kSub
+             + static_cast<size_t>((v >> (msb - kSubBits)) & (kSub - 1));
+    }
+
+    static uint64_t upper_bound(size_t idx) {
+        if (idx < kSub) return idx;
+        size_t octave = idx / kSub;
+        uint64_t sub = idx % kSub;
+        uint64_t width = 1ull << (octave - 1);
+        return (kSub + sub) * width + (width - 1);
+    }
+
+private:
+    std::atomic<uint64_t> counts_[kBuckets]{};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sum_{0};
+};
+
+} // namespace udp
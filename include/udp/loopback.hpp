@@ -0,0 +1,112 @@
+
+#pragma once
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include "udp/socket.hpp"
+#include "udp/spsc_ring.hpp"
+
+namespace udp {
+
+// Impairments applied to one direction of a loopback link. Every random
+// decision comes from a PRNG seeded with `seed`, so the same send sequence
+// always loses, duplicates and reorders the same datagrams.
+struct LinkImpairment {
+    double loss = 0.0;        // probability a datagram is dropped
+    double duplicate = 0.0;   // probability a datagram is delivered twice
+    double reorder = 0.0;     // probability a datagram is held back behind the next one
+                              // (delivered in order if the link drains first)
+    uint64_t delay_ns = 0;    // fixed one-way delay
+    uint64_t jitter_ns = 0;   // extra uniform delay in [0, jitter_ns)
+    uint64_t seed = 1;
+};
+
+// One direction of an in-process link: an SPSC ring of frames from the
+// sending socket to the receiving one, plus a return ring that recycles frame
+// buffers so the steady state allocates nothing. The rings themselves are
+// lock-free, but each side also takes a mutex: a loopback endpoint cannot form
+// a reuseport group, so several server workers may read (and echo on) one
+// endpoint. With one thread per side the mutexes are never contended.
+//
+// Delivery stays FIFO: a frame whose due time has not arrived blocks the ones
+// behind it, so jitter adds delay but never reorders on its own. A full ring
+// drops the datagram and counts it as a receive overflow, as the kernel would.
+class LoopbackChannel {
+public:
+    LoopbackChannel(const LinkImpairment& imp, size_t ring_size);
+
+    // Sender side; returns the number of datagrams accepted (always all of them).
+    size_t send(const std::vector<std::vector<uint8_t>>& bufs, const SockAddr& from);
+    // Receiver side; fills up to bufs.size() datagrams whose due time has passed.
+    size_t recv(std::vector<std::vector<uint8_t>>& bufs, std::vector<PacketMeta>* meta, bool rx_ts);
+
+    uint64_t sent() const { return sent_.load(std::memory_order_relaxed); }
+    uint64_t delivered() const { return delivered_.load(std::memory_order_relaxed); }
+    uint64_t lost() const { return lost_.load(std::memory_order_relaxed); }
+    uint64_t duplicated() const { return duplicated_.load(std::memory_order_relaxed); }
+    // Datagrams delivered behind a newer one.
+    uint64_t reordered() const { return reordered_.load(std::memory_order_relaxed); }
+    uint64_t overflowed() const { return overflowed_.load(std::memory_order_relaxed); }
+private:
+    struct Frame {
+        std::vector<uint8_t> data;
+        SockAddr from;
+        uint64_t due_ns = 0;  // CLOCK_REALTIME, doubles as the RX timestamp
+    };
+    void enqueue(Frame&& f);
+    bool take_held();
+    Frame make_frame(const std::vector<uint8_t>& buf, const SockAddr& from, uint64_t due);
+    uint64_t next();
+    double uniform() { return static_cast<double>(next() >> 11) * 0x1.0p-53; }
+
+    LinkImpairment imp_;
+    SpscRing<Frame> data_;
+    SpscRing<Frame> free_;
+    // Serialise the producer and consumer sides for callers sharing an endpoint.
+    std::mutex tx_mu_;
+    std::mutex rx_mu_;
+    uint64_t rng_;
+    Frame held_;            // reorder: waits for the next datagram (sender side, tx_mu_)
+    std::atomic<bool> has_held_{false};  // read unlocked by an idle receiver
+    Frame head_;            // popped but not yet due (receiver side)
+    bool has_head_{false};
+    std::atomic<uint64_t> sent_{0}, delivered_{0}, lost_{0}, duplicated_{0}, reordered_{0}, overflowed_{0};
+};
+
+// ISocket endpoint of an in-process link, for benchmarking and for tests that
+// need a real client talking to a real server with the kernel taken out.
+// bind()/connect() only record addresses; each endpoint has exactly one peer.
+class LoopbackSocket : public ISocket {
+public:
+    LoopbackSocket(std::shared_ptr<LoopbackChannel> tx, std::shared_ptr<LoopbackChannel> rx,
+                   const SockAddr& local);
+    int fd() const override { return -1; }
+    void bind(uint16_t port, bool reuseport) override;
+    bool bound() const override { return bound_; }
+    void connect(const std::string& ip, uint16_t port) override;
+    ssize_t recv_batch(std::vector<std::vector<uint8_t>>& bufs,
+                       std::vector<PacketMeta>* meta = nullptr) override;
+    ssize_t send_batch(const std::vector<std::vector<uint8_t>>& bufs,
+                       const std::vector<PacketMeta>* meta = nullptr) override;
+    uint64_t rx_dropped() const override { return rx_->overflowed(); }
+    // RX stamps are the simulated arrival time; TX stamps are not supported.
+    bool enable_timestamps(bool rx, bool tx) override;
+private:
+    std::shared_ptr<LoopbackChannel> tx_;
+    std::shared_ptr<LoopbackChannel> rx_;
+    SockAddr local_;
+    bool bound_{false};
+    bool rx_timestamps_{false};
+};
+
+struct LoopbackPair {
+    std::unique_ptr<LoopbackSocket> a;   // e.g. the client, 127.0.0.1:40000
+    std::unique_ptr<LoopbackSocket> b;   // e.g. the server, 127.0.0.1:9000
+    std::shared_ptr<LoopbackChannel> a_to_b;
+    std::shared_ptr<LoopbackChannel> b_to_a;
+};
+
+LoopbackPair make_loopback_pair(const LinkImpairment& a_to_b = {}, const LinkImpairment& b_to_a = {},
+                                size_t ring_size = 1 << 14);
+
+} // namespace udp
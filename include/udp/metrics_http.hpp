@@ -3,6 +3,10 @@
 #include <thread>
 #include <atomic>
 #include <string>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <vector>
 #include "udp/stats.hpp"
 
 namespace udp {
@@ -13,10 +17,15 @@ public:
     ~MetricsHttpServer();
     void start();
     void stop();
+    // Extra exposition text appended after the Stats metrics on every scrape.
+    using Collector = std::function<void(std::ostream&)>;
+    void add_collector(Collector c);
+    std::string render();
 private:
     void run();
-    std::string render();
     Stats& stats_;
+    std::mutex collectors_mu_;
+    std::vector<Collector> collectors_;
     uint16_t port_;
     std::thread th_;
     std::atomic<bool> running_{false};
@@ -0,0 +1,62 @@
+
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+namespace udp {
+
+struct RateLimitConfig {
+    uint64_t client_pps = 0;     // per-source rate, 0 = unlimited
+    uint64_t client_burst = 0;   // per-source burst (packets), 0 = one second of rate
+    uint64_t global_pps = 0;     // aggregate ceiling, 0 = unlimited
+    uint64_t global_burst = 0;   // aggregate burst (packets), 0 = one second of rate
+    size_t table_size = 1 << 17; // tracked sources, rounded up to a power of two
+};
+
+// Token-bucket admission control keyed by source address (see addr_hash()).
+//
+// Buckets are kept in GCRA form (a single "theoretical arrival time" per
+// source), which is equivalent to a token bucket but needs no floating point
+// and only 16 bytes of state. The table is open-addressed with short linear
+// probes; when a probe window is full the entry with the oldest arrival time
+// is recycled, but only if that time is already in the past: such an entry
+// describes a full bucket, so recycling it loses no enforcement state. If
+// every entry in the window is still throttled, the new source is charged to
+// one shared overflow bucket (at the per-source rate) instead, so rotating
+// spoofed sources cannot evict a limited bucket and restore its burst.
+class RateLimiter {
+public:
+    enum class Verdict : uint8_t { Admit, ClientLimited, GlobalLimited };
+
+    explicit RateLimiter(const RateLimitConfig& cfg);
+
+    bool enabled() const { return client_interval_ns_ != 0 || global_interval_ns_ != 0; }
+    Verdict admit(uint64_t addr_key, uint64_t now_ns);
+
+    size_t capacity() const { return table_.size(); }
+    size_t tracked() const { return tracked_; }
+    uint64_t evictions() const { return evictions_; }
+    uint64_t overflowed() const { return overflowed_; }
+
+private:
+    struct Entry {
+        uint64_t tat;     // theoretical arrival time (ns)
+        uint64_t key;     // address fingerprint, 0 = empty slot
+    };
+    static constexpr size_t kMaxProbe = 8;
+
+    Entry& lookup(uint64_t key, uint64_t now_ns);
+
+    std::vector<Entry> table_;
+    size_t mask_;
+    size_t tracked_{0};
+    uint64_t evictions_{0};
+    uint64_t overflowed_{0};
+    Entry overflow_{0, 0};
+    uint64_t client_interval_ns_{0}, client_tolerance_ns_{0};
+    uint64_t global_interval_ns_{0}, global_tolerance_ns_{0};
+    uint64_t global_tat_{0};
+};
+
+} // namespace udp
@@ -4,20 +4,52 @@
 #include <atomic>
 #include <thread>
 #include <memory>
+#include <mutex>
 #include "udp/socket.hpp"
 #include "udp/stats.hpp"
 #include "udp/common.hpp"
 #include "udp/metrics_http.hpp"
+#include "udp/rate_limiter.hpp"
+#include "udp/autotune.hpp"
+#include "udp/spsc_ring.hpp"
+#include "udp/topology.hpp"
+#include "udp/flow_table.hpp"
 
 namespace udp {
 
 struct ServerConfig {
     uint16_t port = 9000;
     int batch = 64;
+    int workers = 1;          // receive threads, each on its own SO_REUSEPORT socket when possible
+    int proc_threads = 0;     // processing threads per receive thread, 0 = process inline
+    size_t ring_size = 4096;  // descriptors per receive->processing ring
     bool echo = false;
     bool reuseport = false;
+    bool reloadable = false;  // workers may grow at runtime, so always bind in a reuseport group
+    AddressFamily family = AddressFamily::V4;
     bool verbose = true;
+    bool timestamps = false;  // kernel RX timestamps for latency breakdown
     uint16_t metrics_port = 9100;
+    int rcvbuf = 1 << 20;     // initial SO_RCVBUF request (bytes)
+    int sndbuf = 1 << 20;     // SO_SNDBUF request (bytes)
+    bool pin_workers = false; // pin threads to CPUs on the NUMA node local to the RX queue
+    std::string nic;          // interface for NIC NUMA node and IRQ affinity report
+    RateLimitConfig rate_limit;
+    AutotuneConfig autotune;
+    FlowConfig flows;         // per-thread flow table (capacity, idle expiry)
+};
+
+// Where a receive thread runs; cpu/node are -1 when unknown.
+struct WorkerPlacement {
+    int cpu = -1;
+    int node = -1;
+    bool pinned = false;
+};
+
+// Owning buffer descriptor handed from a receive thread to a processing thread.
+struct PacketDesc {
+    std::vector<uint8_t> buf;
+    PacketMeta meta;
 };
 
 class UdpServer {
@@ -26,17 +58,89 @@ public:
     ~UdpServer();
     void start();
     void stop();
+    // Applies the settings that can change without rebinding: worker count and
+    // batch size. Other fields of `next` are ignored. Returns false, keeping
+    // the current workers, if a real socket cannot open a reuseport group
+    // member for each added worker (new workers would split flows).
+    bool reconfigure(const ServerConfig& next);
+    // Extra members of the socket's SO_REUSEPORT group, e.g. inherited from a
+    // predecessor. Call before start(); workers use them before opening new ones.
+    void add_sockets(std::vector<std::unique_ptr<ISocket>> extra);
+    size_t worker_count() const;
+    ISocket& socket() { return *sock_; }
+    // Every socket the workers read, primary first (for handoff to a successor).
+    std::vector<int> socket_fds() const;
     double last_rate_pps() const { return last_rate_pps_; }
     const Stats& stats() const { return stats_; }
+    int batch_size() const { return batch_now_.load(std::memory_order_relaxed); }
+    int rcvbuf_bytes() const { return rcvbuf_bytes_.load(std::memory_order_relaxed); }
+    std::vector<WorkerPlacement> placement() const;
+    const Topology& topology() const { return topo_; }
 private:
-    void run_loop();
+    // Staged mode: one processing thread fed by its own SPSC ring pair. Full
+    // descriptors flow receive -> processing; emptied buffers flow back so
+    // steady state allocates nothing.
+    struct Stage {
+        explicit Stage(size_t cap) : full(cap), free(cap) {}
+        SpscRing<PacketDesc> full;
+        SpscRing<std::vector<uint8_t>> free;
+        std::thread th;
+        std::atomic<bool> stop{false};
+        std::atomic<int> node{-1};  // NUMA node the owning receive thread moved to
+        ISocket* sock = nullptr;    // the owning receive thread's socket; echoes go out here
+    };
+    // Each receive thread reads its own member of the socket's SO_REUSEPORT
+    // group, so the kernel keeps every flow on one worker (and one flow
+    // table). Sockets that cannot form a group are shared instead.
+    struct Worker {
+        ISocket* sock = nullptr;
+        std::unique_ptr<ISocket> own_sock;  // reuseport sibling; null for worker 0 or when shared
+        bool owns_socket = false;           // accounts the socket's kernel drops
+        std::thread th;
+        std::atomic<bool> running{true};
+        std::vector<std::unique_ptr<Stage>> stages;
+        std::atomic<int> cpu{-1}, node{-1};
+        std::atomic<bool> pinned{false};
+    };
+    void spawn_worker();
+    void retire_worker(Worker& w);
+    void run_loop(Worker* self, size_t index);
+    void process_loop(Stage* st);
+    void dispatch(Worker* self, std::vector<std::vector<uint8_t>>& bufs,
+                  std::vector<PacketMeta>& meta, size_t n);
+    void handle_batch(ISocket& sock, std::vector<std::vector<uint8_t>>& bufs,
+                      std::vector<PacketMeta>& meta, size_t n, FlowTable& flows);
+    void configure_socket(ISocket& s);
+    void apply_tuning(ISocket& sock, const BatchTuner& tuner, const BatchTuner::Decision& d);
+    void render_tuning(std::ostream& os) const;
+    void render_staging(std::ostream& os) const;
+    void render_placement(std::ostream& os) const;
+    std::vector<int> node_cpus(int node) const;
+    void place_worker(Worker* self, size_t index, int node);
+    void report_irqs() const;
     std::unique_ptr<ISocket> sock_;
+    std::vector<std::unique_ptr<ISocket>> spare_socks_;  // inherited group members not yet in use
+    bool shared_warned_{false};
     ServerConfig cfg_;
     Stats stats_;
+    RateLimiter limiter_;
+    std::mutex limiter_mu_;   // workers share one limiter; taken once per batch
     std::unique_ptr<MetricsHttpServer> metrics_;
-    std::thread th_;
+    mutable std::mutex workers_mu_;
+    std::vector<std::unique_ptr<Worker>> workers_;
     std::atomic<bool> running_{false};
+    std::atomic<int> batch_target_{0};
+    std::atomic<uint32_t> reconfig_gen_{0};
     double last_rate_pps_{0.0};
+    std::atomic<int> batch_now_{0};
+    std::atomic<int> rcvbuf_bytes_{0};
+    std::atomic<uint32_t> fill_permille_{0};
+    std::atomic<uint64_t> tune_grow_{0}, tune_shrink_{0}, rcvbuf_raises_{0};
+    std::atomic<uint64_t> ring_full_stalls_{0}, ring_empty_polls_{0};
+    Topology topo_;
+    std::vector<int> allowed_cpus_;
+    int home_node_{-1};               // NIC-local node, -1 until known
+    std::vector<IrqAffinity> irqs_;
 };
 
 } // namespace udp
@@ -1,68 +1,157 @@
 
 #pragma once
+#include <algorithm>
 #include <vector>
 #include <string>
 #include <cstdint>
 #include <atomic>
+#include <memory>
+#include <mutex>
 #include <netinet/in.h>
 #include <sys/socket.h>
 #include <unistd.h>
+#include "udp/address.hpp"
 
 namespace udp {
 
+// Per-datagram metadata filled by recv_batch when the caller asks for it, and
+// consumed by send_batch on unconnected sockets to address each datagram.
+struct PacketMeta {
+    SockAddr peer;        // source (recv) or destination (send) address
+    uint32_t len = 0;     // bytes actually received (<= buffer size)
+    uint64_t rx_ts_ns = 0;  // kernel RX timestamp (CLOCK_REALTIME ns), 0 if not enabled
+};
+
+// Kernel software TX timestamp. `id` counts datagrams sent since timestamping
+// was enabled (SOF_TIMESTAMPING_OPT_ID), starting at 0.
+struct TxTimestamp {
+    uint32_t id;
+    uint64_t ts_ns;
+};
+
 class ISocket {
 public:
     virtual ~ISocket() = default;
     virtual int fd() const = 0;
     virtual void bind(uint16_t port, bool reuseport) = 0;
+    // True once the socket has a local port (bound here or inherited via handoff).
+    virtual bool bound() const { return false; }
     virtual void connect(const std::string& ip, uint16_t port) = 0;
-    virtual ssize_t recv_batch(std::vector<std::vector<uint8_t>>& bufs) = 0;
+    virtual ssize_t recv_batch(std::vector<std::vector<uint8_t>>& bufs,
+                               std::vector<PacketMeta>* meta = nullptr) = 0;
     virtual ssize_t send_batch(const std::vector<std::vector<uint8_t>>& bufs,
-                               const sockaddr_in* addr = nullptr) = 0;
+                               const std::vector<PacketMeta>* meta = nullptr) = 0;
+    // Blocks up to timeout_ms until a datagram, or an error-queue entry such as
+    // a TX timestamp, is ready; returns false on timeout. The caller must
+    // drain both or the next call returns at once. Sockets without a pollable
+    // fd just yield and return true.
+    virtual bool wait_readable(int timeout_ms);
     virtual void set_rcvbuf(int bytes);
     virtual void set_sndbuf(int bytes);
+    // Effective buffer sizes as reported by the kernel (0 if unknown).
+    virtual int rcvbuf() const { return 0; }
+    virtual int sndbuf() const { return 0; }
+    // The kernel reports twice the requested size (it counts bookkeeping
+    // overhead), so a read-back below 2x the request means it was capped by
+    // net.core.[rw]mem_max. An unknown size (0) is never reported as capped.
+    static bool buffer_capped(int requested, int reported) {
+        return reported > 0 && static_cast<int64_t>(reported) < 2 * static_cast<int64_t>(requested);
+    }
+    // Cumulative datagrams dropped by the kernel on receive-queue overflow.
+    virtual uint64_t rx_dropped() const { return 0; }
+    // CPU that processed the most recent incoming packet (SO_INCOMING_CPU), -1 if unknown.
+    virtual int incoming_cpu() const { return -1; }
+    // Opens another socket bound to the same local address in this socket's
+    // SO_REUSEPORT group. The kernel hashes each flow (4-tuple) to one member,
+    // so a flow's datagrams all land on the same socket. Returns nullptr when
+    // unsupported, e.g. this socket was not bound with SO_REUSEPORT.
+    virtual std::unique_ptr<ISocket> reuseport_sibling() { return nullptr; }
+    // Kernel timestamping; returns false when unsupported.
+    virtual bool enable_timestamps(bool rx, bool tx);
+    // Drains pending TX timestamps into `out`, returns how many were appended.
+    virtual size_t read_tx_timestamps(std::vector<TxTimestamp>& out);
 };
 
 class UdpSocket : public ISocket {
 public:
-    explicit UdpSocket(int batch_hint = 64);
+    explicit UdpSocket(int batch_hint = 64, AddressFamily family = AddressFamily::V4);
     ~UdpSocket() override;
+    // Takes ownership of an existing UDP socket, e.g. one received from a
+    // predecessor process during a zero-downtime restart.
+    static std::unique_ptr<UdpSocket> adopt(int fd, int batch_hint = 64);
 
     int fd() const override { return sockfd_; }
     void bind(uint16_t port, bool reuseport) override;
+    bool bound() const override { return bound_; }
     void connect(const std::string& ip, uint16_t port) override;
-    ssize_t recv_batch(std::vector<std::vector<uint8_t>>& bufs) override;
+    ssize_t recv_batch(std::vector<std::vector<uint8_t>>& bufs,
+                       std::vector<PacketMeta>* meta = nullptr) override;
     ssize_t send_batch(const std::vector<std::vector<uint8_t>>& bufs,
-                       const sockaddr_in* addr = nullptr) override;
+                       const std::vector<PacketMeta>* meta = nullptr) override;
+    bool wait_readable(int timeout_ms) override;
     void set_rcvbuf(int bytes) override;
     void set_sndbuf(int bytes) override;
+    int rcvbuf() const override;
+    int sndbuf() const override;
+    uint64_t rx_dropped() const override { return rx_dropped_.load(std::memory_order_relaxed); }
+    int incoming_cpu() const override;
+    std::unique_ptr<ISocket> reuseport_sibling() override;
+    bool enable_timestamps(bool rx, bool tx) override;
+    size_t read_tx_timestamps(std::vector<TxTimestamp>& out) override;
 private:
+    UdpSocket(int fd, int batch_hint, int domain);
     int sockfd_;
     int batch_hint_;
+    int domain_;
     bool connected_;
-    sockaddr_in peer_{};
+    bool bound_{false};
+    bool rx_timestamps_{false};
+    bool tx_timestamps_{false};
+    SockAddr peer_;
+    std::atomic<uint64_t> rx_dropped_{0};
 };
 
+// In-memory socket for tests. recv/send are serialised so several server
+// threads (workers, processing stages) may share one instance.
 class MockSocket : public ISocket {
 public:
     MockSocket() : recv_cursor_(0) {}
     int fd() const override { return -1; }
     void bind(uint16_t, bool) override {}
     void connect(const std::string&, uint16_t) override {}
-    ssize_t recv_batch(std::vector<std::vector<uint8_t>>& bufs) override;
+    ssize_t recv_batch(std::vector<std::vector<uint8_t>>& bufs,
+                       std::vector<PacketMeta>* meta = nullptr) override;
     ssize_t send_batch(const std::vector<std::vector<uint8_t>>& bufs,
-                       const sockaddr_in* addr = nullptr) override;
-    void set_rcvbuf(int) override {}
-    void set_sndbuf(int) override {}
+                       const std::vector<PacketMeta>* meta = nullptr) override;
+    void set_rcvbuf(int bytes) override { if (buf_cap_) rcvbuf_ = 2 * std::min(bytes, buf_cap_); }
+    void set_sndbuf(int bytes) override { if (buf_cap_) sndbuf_ = 2 * std::min(bytes, buf_cap_); }
+    int rcvbuf() const override { return rcvbuf_; }
+    int sndbuf() const override { return sndbuf_; }
 
     // test hooks
-    void preload_recv(const std::vector<uint8_t>& pkt) { rx_store_.push_back(pkt); }
+    // Emulates a kernel with net.core.[rw]mem_max = `max_bytes`: buffer sizes
+    // are clamped and read back doubled. Without it sizes read back as unknown.
+    void emulate_buffer_cap(int max_bytes) { buf_cap_ = max_bytes; }
+    void preload_recv(const std::vector<uint8_t>& pkt, const SockAddr& peer = SockAddr{},
+                      uint64_t rx_ts_ns = 0) {
+        rx_store_.push_back(pkt);
+        rx_peers_.push_back(peer);
+        rx_ts_.push_back(rx_ts_ns);
+    }
     size_t sent_count() const { return tx_store_.size(); }
     const std::vector<std::vector<uint8_t>>& sent() const { return tx_store_; }
+    const std::vector<SockAddr>& sent_peers() const { return tx_peers_; }
 private:
+    std::mutex mu_;
     std::vector<std::vector<uint8_t>> rx_store_;
+    std::vector<SockAddr> rx_peers_;
+    std::vector<uint64_t> rx_ts_;
     std::vector<std::vector<uint8_t>> tx_store_;
+    std::vector<SockAddr> tx_peers_;
     size_t recv_cursor_;
+    int buf_cap_ = 0;
+    int rcvbuf_ = 0;
+    int sndbuf_ = 0;
 };
 
 } // namespace udp
@@ -0,0 +1,76 @@
+
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace udp {
+
+static constexpr size_t kCacheLine = 64;
+
+// Bounded lock-free single-producer / single-consumer ring.
+//
+// Producer and consumer indices live on separate cache lines, and each side
+// keeps a private copy of the other side's index so the shared line is only
+// re-read when the ring looks full (producer) or empty (consumer). Capacity is
+// rounded up to a power of two. Elements are moved in and out, so a slot can
+// carry an owning buffer without copying its payload.
+template <typename T>
+class alignas(kCacheLine) SpscRing {
+public:
+    explicit SpscRing(size_t capacity)
+    : slots_(round_pow2(capacity < 2 ? 2 : capacity)), mask_(slots_.size() - 1) {}
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    // Producer side.
+    bool try_push(T&& v) {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_cache_ > mask_) {
+            head_cache_ = head_.load(std::memory_order_acquire);
+            if (tail - head_cache_ > mask_) return false;
+        }
+        slots_[tail & mask_] = std::move(v);
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side.
+    bool try_pop(T& out) {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_cache_) {
+            tail_cache_ = tail_.load(std::memory_order_acquire);
+            if (head == tail_cache_) return false;
+        }
+        out = std::move(slots_[head & mask_]);
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Approximate when called from a third thread (e.g. a metrics scrape).
+    size_t size() const {
+        const size_t tail = tail_.load(std::memory_order_acquire);
+        const size_t head = head_.load(std::memory_order_acquire);
+        return tail - head;
+    }
+    bool empty() const { return size() == 0; }
+    size_t capacity() const { return slots_.size(); }
+
+private:
+    static size_t round_pow2(size_t n) {
+        size_t p = 1;
+        while (p < n) p <<= 1;
+        return p;
+    }
+
+    std::vector<T> slots_;
+    const size_t mask_;
+    alignas(kCacheLine) std::atomic<size_t> head_{0};  // consumer-owned
+    size_t tail_cache_{0};                             // consumer's view of tail_
+    alignas(kCacheLine) std::atomic<size_t> tail_{0};  // producer-owned
+    size_t head_cache_{0};                             // producer's view of head_
+};
+
+} // namespace udp
@@ -1,24 +1,60 @@
 
 #pragma once
 #include <atomic>
-#include <unordered_map>
-#include <mutex>
 #include <netinet/in.h>
 #include <string>
 #include <sstream>
+#include "udp/address.hpp"
+#include "udp/distinct_counter.hpp"
+#include "udp/histogram.hpp"
 
 namespace udp {
 
-struct ClientKey {
-    uint32_t addr;
-    uint16_t port;
-    bool operator==(const ClientKey& o) const { return addr==o.addr && port==o.port; }
+// Reasons a received packet may be discarded before processing.
+enum class DropReason : uint8_t {
+    ClientRate = 0,   // per-source token bucket exhausted
+    GlobalRate,       // global ingress ceiling exhausted
+    SocketOverflow,   // kernel receive queue full (SO_RXQ_OVFL)
+    RingFull,         // staged mode: processing ring full, receive thread shed the packet
+    Count
 };
 
-struct ClientKeyHash {
-    size_t operator()(const ClientKey& k) const {
-        return (static_cast<size_t>(k.addr) << 16) ^ k.port;
+inline const char* drop_reason_name(DropReason r) {
+    switch (r) {
+        case DropReason::ClientRate: return "client_rate";
+        case DropReason::GlobalRate: return "global_rate";
+        case DropReason::SocketOverflow: return "socket_overflow";
+        case DropReason::RingFull: return "ring_full";
+        default: return "unknown";
     }
+}
+
+// Latency components derived from kernel timestamps.
+enum class LatencyStage : uint8_t {
+    Network = 0,  // sender user-space stamp -> kernel RX stamp (needs synced clocks)
+    Queueing,     // kernel RX stamp -> returned from recv_batch
+    Processing,   // returned from recv_batch -> batch handled, once per packet in it
+    TxStack,      // client user-space stamp -> kernel TX stamp
+    Rtt,          // client send -> echo received (RTT mode)
+    Count
+};
+
+inline const char* latency_stage_name(LatencyStage s) {
+    switch (s) {
+        case LatencyStage::Network: return "network";
+        case LatencyStage::Queueing: return "queueing";
+        case LatencyStage::Processing: return "processing";
+        case LatencyStage::TxStack: return "tx_stack";
+        case LatencyStage::Rtt: return "rtt";
+        default: return "unknown";
+    }
+}
+
+// Flow-table totals shared by every worker's FlowTable.
+struct FlowCounters {
+    std::atomic<int64_t> active{0};
+    std::atomic<uint64_t> created{0}, expired{0}, rejected{0};
+    std::atomic<uint64_t> lost{0}, reordered{0}, duplicates{0};
 };
 
 class Stats {
@@ -27,30 +63,44 @@ public:
     void inc_recv(uint64_t n) { recv_.fetch_add(n, std::memory_order_relaxed); }
     void add_rx_bytes(uint64_t n) { rx_bytes_.fetch_add(n, std::memory_order_relaxed); }
     void add_tx_bytes(uint64_t n) { tx_bytes_.fetch_add(n, std::memory_order_relaxed); }
-    void note_client(uint32_t addr, uint16_t port) {
-        std::lock_guard<std::mutex> lg(mu_);
-        clients_[ClientKey{addr,port}]++;
-    }
-    size_t unique_clients() const {
-        std::lock_guard<std::mutex> lg(mu_);
-        return clients_.size();
+    void inc_dropped(DropReason r, uint64_t n) {
+        dropped_[static_cast<size_t>(r)].fetch_add(n, std::memory_order_relaxed);
     }
+    // Idempotent; the server notes a client each time a flow table sees a new flow.
+    void note_client(const ClientKey& k) { clients_.add(ClientKeyHash{}(k)); }
+    void note_client(uint32_t addr, uint16_t port) { note_client(make_client_key(addr, port)); }
+    // Distinct clients (address and port) ever seen. Estimated in fixed memory,
+    // so it stays bounded under ephemeral-port churn; active flows are in flows().
+    size_t unique_clients() const { return static_cast<size_t>(clients_.estimate()); }
+    FlowCounters& flows() { return flows_; }
+    const FlowCounters& flows() const { return flows_; }
     uint64_t sent() const { return sent_.load(); }
     uint64_t recv() const { return recv_.load(); }
     uint64_t rx_bytes() const { return rx_bytes_.load(); }
     uint64_t tx_bytes() const { return tx_bytes_.load(); }
+    void record_latency(LatencyStage s, uint64_t ns, uint64_t n = 1) { latency_[static_cast<size_t>(s)].record(ns, n); }
+    const LatencyHistogram& latency(LatencyStage s) const { return latency_[static_cast<size_t>(s)]; }
+    uint64_t dropped(DropReason r) const { return dropped_[static_cast<size_t>(r)].load(); }
+    uint64_t dropped_total() const {
+        uint64_t t = 0;
+        for (auto& d : dropped_) t += d.load();
+        return t;
+    }
 
     std::string to_string() const {
         std::ostringstream oss;
         oss << "recv=" << recv() << " sent=" << sent()
             << " unique_clients=" << unique_clients()
-            << " rx_bytes=" << rx_bytes() << " tx_bytes=" << tx_bytes();
+            << " rx_bytes=" << rx_bytes() << " tx_bytes=" << tx_bytes()
+            << " dropped=" << dropped_total();
         return oss.str();
     }
 private:
     std::atomic<uint64_t> sent_{0}, recv_{0}, rx_bytes_{0}, tx_bytes_{0};
-    mutable std::mutex mu_;
-    std::unordered_map<ClientKey, uint64_t, ClientKeyHash> clients_;
+    std::atomic<uint64_t> dropped_[static_cast<size_t>(DropReason::Count)]{};
+    LatencyHistogram latency_[static_cast<size_t>(LatencyStage::Count)];
+    FlowCounters flows_;
+    DistinctCounter clients_;
 };
 
 } // namespace udp
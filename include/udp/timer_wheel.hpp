@@ -0,0 +1,133 @@
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace udp {
+
+// Hierarchical timing wheel over a fixed set of timer ids [0, capacity).
+//
+// Four levels of 64 slots; level l slot width is 64^l ticks, so deadlines up
+// to 64^3 ticks ahead are exact (at 10 ms ticks that is ~43 minutes). Further
+// deadlines are clamped and fire early; callers that re-check their own
+// deadline (as FlowTable does) simply schedule again. Timers are intrusive
+// doubly-linked lists over index arrays: schedule, cancel and per-tick work
+// are O(1) and nothing is allocated after construction.
+//
+// Not thread-safe: owned and advanced by one thread.
+class TimerWheel {
+public:
+    static constexpr uint32_t kNone = ~0u;
+
+    TimerWheel(size_t capacity, uint64_t tick_ns, uint64_t now_ns)
+    : tick_ns_(tick_ns ? tick_ns : 1), now_tick_(now_ns / tick_ns_),
+      next_(capacity, kNone), prev_(capacity, kNone), slot_of_(capacity, kNone), due_(capacity, 0) {
+        heads_.assign(kLevels * kSlots, kNone);
+    }
+
+    // (Re)arms timer `id` to fire at the first tick at or after `deadline_ns`.
+    void schedule(uint32_t id, uint64_t deadline_ns) {
+        cancel(id);
+        uint64_t t = (deadline_ns + tick_ns_ - 1) / tick_ns_;
+        if (t <= now_tick_) t = now_tick_ + 1;
+        if (t - now_tick_ >= kSpan) t = now_tick_ + kSpan - 1;
+        due_[id] = t;
+        place(id);
+        ++armed_;
+    }
+
+    void cancel(uint32_t id) {
+        if (slot_of_[id] == kNone) return;
+        unlink(id);
+        --armed_;
+    }
+
+    bool armed(uint32_t id) const { return slot_of_[id] != kNone; }
+    size_t armed_count() const { return armed_; }
+    uint64_t now_tick() const { return now_tick_; }
+
+    // Advances to `now_ns`, calling fire(id) for each timer that came due.
+    // A callback may schedule the id it is given again. Returns timers fired.
+    template <typename F>
+    size_t advance(uint64_t now_ns, F&& fire) {
+        const uint64_t target = now_ns / tick_ns_;
+        size_t fired = 0;
+        while (now_tick_ < target) {
+            if (armed_ == 0) { now_tick_ = target; break; }
+            ++now_tick_;
+            // Cascade coarser levels whose slot boundary we just crossed,
+            // highest first, so their timers land in finer slots in time.
+            for (int l = kLevels - 1; l > 0; --l) {
+                if ((now_tick_ & ((uint64_t(1) << (kBits * l)) - 1)) == 0) cascade(l);
+            }
+            uint32_t id = take(0, now_tick_ & kMask);
+            while (id != kNone) {
+                uint32_t nxt = next_[id];
+                slot_of_[id] = kNone;
+                --armed_;
+                ++fired;
+                fire(id);
+                id = nxt;
+            }
+        }
+        return fired;
+    }
+
+private:
+    static constexpr int kBits = 6;
+    static constexpr int kLevels = 4;
+    static constexpr uint32_t kSlots = 1u << kBits;
+    static constexpr uint64_t kMask = kSlots - 1;
+    static constexpr uint64_t kSpan = uint64_t(1) << (kBits * (kLevels - 1));
+
+    // The level is picked from the highest bit where the deadline differs
+    // from the current tick, so a timer sits at the finest level whose
+    // rotation will still pass its slot before it is due.
+    void place(uint32_t id) {
+        const uint64_t t = due_[id];
+        const uint64_t diff = t ^ now_tick_;
+        int level = 0;
+        while (level < kLevels - 1 && (diff >> (kBits * (level + 1))) != 0) ++level;
+        const uint32_t slot = level * kSlots + static_cast<uint32_t>((t >> (kBits * level)) & kMask);
+        prev_[id] = kNone;
+        next_[id] = heads_[slot];
+        if (heads_[slot] != kNone) prev_[heads_[slot]] = id;
+        heads_[slot] = id;
+        slot_of_[id] = slot;
+    }
+
+    void unlink(uint32_t id) {
+        const uint32_t slot = slot_of_[id];
+        if (prev_[id] != kNone) next_[prev_[id]] = next_[id];
+        else heads_[slot] = next_[id];
+        if (next_[id] != kNone) prev_[next_[id]] = prev_[id];
+        slot_of_[id] = kNone;
+    }
+
+    // Detaches a whole slot and returns its first id (the list stays linked by next_).
+    uint32_t take(int level, uint64_t slot) {
+        const uint32_t s = level * kSlots + static_cast<uint32_t>(slot);
+        uint32_t head = heads_[s];
+        heads_[s] = kNone;
+        return head;
+    }
+
+    void cascade(int level) {
+        uint32_t id = take(level, (now_tick_ >> (kBits * level)) & kMask);
+        while (id != kNone) {
+            uint32_t nxt = next_[id];
+            place(id);
+            id = nxt;
+        }
+    }
+
+    uint64_t tick_ns_;
+    uint64_t now_tick_;
+    std::vector<uint32_t> heads_;
+    std::vector<uint32_t> next_, prev_, slot_of_;
+    std::vector<uint64_t> due_;  // deadline in ticks
+    size_t armed_{0};
+};
+
+} // namespace udp
@@ -0,0 +1,52 @@
+
+#pragma once
+#include <string>
+#include <vector>
+
+namespace udp {
+
+struct CpuInfo {
+    int cpu = -1;
+    int node = 0;      // NUMA node (0 on machines without NUMA information)
+    int core = -1;     // core_id within the package
+    int package = -1;  // physical_package_id (socket)
+};
+
+// CPU and NUMA layout read from sysfs at startup. The roots are parameters so
+// tests can point discovery at a fake tree.
+class Topology {
+public:
+    static Topology discover(const std::string& sys_root = "/sys");
+
+    const std::vector<CpuInfo>& cpus() const { return cpus_; }
+    int node_count() const { return nodes_; }
+    // NUMA node of `cpu`, or -1 if the CPU is unknown.
+    int node_of(int cpu) const;
+    std::vector<int> cpus_on_node(int node) const;
+
+    // Parses a kernel cpulist such as "0-3,8,10-11".
+    static std::vector<int> parse_cpulist(const std::string& s);
+private:
+    std::vector<CpuInfo> cpus_;
+    int nodes_ = 1;
+};
+
+// CPUs this process may run on (sched_getaffinity).
+std::vector<int> allowed_cpus();
+// Pins the calling thread to `cpus`; returns false if the kernel refused.
+bool pin_current_thread(const std::vector<int>& cpus);
+
+struct IrqAffinity {
+    int irq = -1;
+    std::string name;        // e.g. "eth0-TxRx-3", empty when unknown
+    std::vector<int> cpus;   // effective affinity (smp_affinity_list)
+};
+
+// NUMA node the NIC hangs off, or -1 if unknown (virtual devices, no NUMA).
+int nic_numa_node(const std::string& nic, const std::string& sys_root = "/sys");
+// IRQs belonging to `nic` and where they are allowed to run: MSI vectors from
+// sysfs first, falling back to matching the name in /proc/interrupts.
+std::vector<IrqAffinity> nic_irqs(const std::string& nic, const std::string& sys_root = "/sys",
+                                  const std::string& proc_root = "/proc");
+
+} // namespace udp
@@ -0,0 +1,77 @@
+
+#include "udp/address.hpp"
+#include <arpa/inet.h>
+
+namespace udp {
+
+uint16_t SockAddr::port() const {
+    if (family() == AF_INET) return ntohs(v4.sin_port);
+    if (family() == AF_INET6) return ntohs(v6.sin6_port);
+    return 0;
+}
+
+bool parse_address(const std::string& ip, uint16_t port, SockAddr& out) {
+    out = SockAddr{};
+    if (inet_pton(AF_INET, ip.c_str(), &out.v4.sin_addr) == 1) {
+        out.v4.sin_family = AF_INET;
+        out.v4.sin_port = htons(port);
+        out.len = sizeof(sockaddr_in);
+        return true;
+    }
+    if (inet_pton(AF_INET6, ip.c_str(), &out.v6.sin6_addr) == 1) {
+        out.v6.sin6_family = AF_INET6;
+        out.v6.sin6_port = htons(port);
+        out.len = sizeof(sockaddr_in6);
+        return true;
+    }
+    return false;
+}
+
+SockAddr to_v4_mapped(const SockAddr& a) {
+    if (a.family() != AF_INET) return a;
+    SockAddr m;
+    m.v6.sin6_family = AF_INET6;
+    m.v6.sin6_port = a.v4.sin_port;
+    m.v6.sin6_addr.s6_addr[10] = 0xff;
+    m.v6.sin6_addr.s6_addr[11] = 0xff;
+    std::memcpy(&m.v6.sin6_addr.s6_addr[12], &a.v4.sin_addr, 4);
+    m.len = sizeof(sockaddr_in6);
+    return m;
+}
+
+std::string to_string(const SockAddr& a) {
+    char buf[INET6_ADDRSTRLEN] = {0};
+    if (a.family() == AF_INET) {
+        inet_ntop(AF_INET, &a.v4.sin_addr, buf, sizeof(buf));
+        return std::string(buf) + ":" + std::to_string(a.port());
+    }
+    if (a.family() == AF_INET6) {
+        inet_ntop(AF_INET6, &a.v6.sin6_addr, buf, sizeof(buf));
+        return "[" + std::string(buf) + "]:" + std::to_string(a.port());
+    }
+    return "unspec";
+}
+
+ClientKey make_client_key(const SockAddr& a) {
+    ClientKey k{0, 0, a.port()};
+    if (a.family() == AF_INET6) {
+        std::memcpy(&k.addr_hi, &a.v6.sin6_addr.s6_addr[0], 8);
+        std::memcpy(&k.addr_lo, &a.v6.sin6_addr.s6_addr[8], 8);
+    } else if (a.family() == AF_INET) {
+        SockAddr m = to_v4_mapped(a);
+        std::memcpy(&k.addr_hi, &m.v6.sin6_addr.s6_addr[0], 8);
+        std::memcpy(&k.addr_lo, &m.v6.sin6_addr.s6_addr[8], 8);
+    }
+    return k;
+}
+
+ClientKey make_client_key(uint32_t addr, uint16_t port) {
+    SockAddr a;
+    a.v4.sin_family = AF_INET;
+    a.v4.sin_addr.s_addr = htonl(addr);
+    a.v4.sin_port = htons(port);
+    a.len = sizeof(sockaddr_in);
+    return make_client_key(a);
+}
+
+} // namespace udp
@@ -0,0 +1,56 @@
+
+#include "udp/autotune.hpp"
+#include <algorithm>
+
+namespace udp {
+
+// Fill ratios outside this band move the batch size by a factor of two.
+static constexpr double kGrowFill = 0.9;
+static constexpr double kShrinkFill = 0.25;
+
+BatchTuner::BatchTuner(const AutotuneConfig& cfg, int initial_batch)
+: cfg_(cfg), batch_(std::min(std::max(initial_batch, cfg.min_batch), cfg.max_batch)) {}
+
+int BatchTuner::next_rcvbuf(int current) const {
+    int64_t next = std::max<int64_t>(current, 1) * 2;
+    return static_cast<int>(std::min<int64_t>(next, cfg_.max_rcvbuf));
+}
+
+BatchTuner::Decision BatchTuner::tick(uint64_t now_ns, uint64_t kernel_drops) {
+    Decision d;
+    d.batch = batch_;
+    if (window_start_ == 0) {
+        window_start_ = now_ns;
+        last_drops_ = kernel_drops;
+        return d;
+    }
+    if (now_ns - window_start_ < cfg_.interval_ns) return d;
+
+    d.evaluated = true;
+    const bool dropping = kernel_drops > last_drops_;
+    last_drops_ = kernel_drops;
+    if (batches_ > 0) {
+        last_fill_ = static_cast<double>(filled_) / static_cast<double>(batches_ * batch_);
+        const uint64_t avg_service = service_ns_ / batches_;
+        const bool over_target = cfg_.latency_target_ns && avg_service > cfg_.latency_target_ns;
+        const bool headroom = !cfg_.latency_target_ns || avg_service * 2 < cfg_.latency_target_ns;
+        if (over_target || (last_fill_ < kShrinkFill && !dropping)) {
+            if (batch_ > cfg_.min_batch) {
+                batch_ = std::max(batch_ / 2, cfg_.min_batch);
+                d.shrank = true;
+            }
+        } else if ((last_fill_ >= kGrowFill || dropping) && headroom) {
+            if (batch_ < cfg_.max_batch) {
+                batch_ = std::min(batch_ * 2, cfg_.max_batch);
+                d.grew = true;
+            }
+        }
+    }
+    d.raise_rcvbuf = dropping;
+    d.batch = batch_;
+    window_start_ = now_ns;
+    batches_ = filled_ = service_ns_ = 0;
+    return d;
+}
+
+} // namespace udp
@@ -11,13 +11,39 @@ namespace udp {
 UdpClient::UdpClient(std::unique_ptr<ISocket> sock, ClientConfig cfg)
 : sock_(std::move(sock)), cfg_(cfg) {
     sock_->connect(cfg_.server_ip, cfg_.port);
-    sock_->set_sndbuf(1<<20);
+    sock_->set_sndbuf(cfg_.sndbuf);
+    int eff = sock_->sndbuf();
+    if (ISocket::buffer_capped(cfg_.sndbuf, eff) && cfg_.verbose) {
+        std::cerr << "[client " << cfg_.id << "] SO_SNDBUF capped at " << eff / 2 << " bytes (requested "
+                  << cfg_.sndbuf << "); raise net.core.wmem_max\n";
+    }
+    if (cfg_.tx_timestamps) {
+        tx_ts_enabled_ = sock_->enable_timestamps(false, true);
+        if (tx_ts_enabled_) tx_sent_ns_.reset(new std::atomic<uint64_t>[kTxRing]());
+        else std::cerr << "[client " << cfg_.id << "] kernel TX timestamps unavailable\n";
+    }
+    if (cfg_.rtt) {
+        // Echoes arrive at the full send rate; size the queue for them.
+        sock_->set_rcvbuf(cfg_.rcvbuf);
+        const int rcv = sock_->rcvbuf();
+        if (ISocket::buffer_capped(cfg_.rcvbuf, rcv) && cfg_.verbose) {
+            std::cerr << "[client " << cfg_.id << "] SO_RCVBUF capped at " << rcv / 2 << " bytes (requested "
+                      << cfg_.rcvbuf << "); raise net.core.rmem_max\n";
+        }
+        outstanding_.reset(new Outstanding[kRttRing]);
+        rtt_seen_.assign(kRttSeen, 0);
+    }
 }
 
 UdpClient::~UdpClient() { stop(); }
 
 void UdpClient::start() {
     running_ = true;
+    if (cfg_.rtt) {
+        // The receiver starts first so no early echo is left unread.
+        rx_running_ = true;
+        rx_th_ = std::thread(&UdpClient::recv_loop, this);
+    }
     th_ = std::thread(&UdpClient::run_loop, this);
 }
 
@@ -26,6 +52,8 @@ void UdpClient::stop() {
         running_ = false;
         th_.join();
     }
+    rx_running_ = false;
+    if (rx_th_.joinable()) rx_th_.join();
 }
 
 void UdpClient::join() {
@@ -33,6 +61,87 @@ void UdpClient::join() {
     if (th_.joinable()) {
         th_.join();
     }
+    // In RTT mode the sender stops the receiver once echoes have drained.
+    if (rx_th_.joinable()) rx_th_.join();
+}
+
+RttReport UdpClient::rtt_report() const {
+    RttReport r;
+    r.sent = stats_.sent();
+    r.received = rtt_matched_.load();
+    r.duplicates = rtt_dups_.load();
+    r.late = rtt_late_.load();
+    r.client_rx_dropped = sock_->rx_dropped();
+    r.send_seconds = send_seconds_;
+    return r;
+}
+
+void UdpClient::recv_loop() {
+    std::vector<std::vector<uint8_t>> bufs(std::max(cfg_.batch, 1), std::vector<uint8_t>(2048));
+    std::vector<PacketMeta> meta(bufs.size());
+    while (rx_running_) {
+        // Pending TX timestamps keep the socket pollable (POLLERR), so this
+        // thread drains them; otherwise wait_readable() would not block.
+        if (tx_ts_enabled_) collect_tx_timestamps();
+        ssize_t r = sock_->recv_batch(bufs, &meta);
+        if (r <= 0) {
+            // Short timeout so stop() is noticed promptly.
+            sock_->wait_readable(10);
+            continue;
+        }
+        const uint64_t now = now_ns();
+        uint64_t bytes = 0;
+        for (ssize_t i=0;i<r;i++) {
+            bytes += meta[i].len;
+            if (meta[i].len < sizeof(PacketHeader)) continue;
+            const auto* hdr = reinterpret_cast<const PacketHeader*>(bufs[i].data());
+            if (hdr->magic != kMagic) continue;
+            const uint64_t sq = hdr->seq;
+            uint64_t& seen = rtt_seen_[sq & (kRttSeen - 1)];
+            if (seen == sq) {
+                rtt_dups_.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            seen = sq;
+            Outstanding& slot = outstanding_[sq & (kRttRing - 1)];
+            uint64_t cur = sq;
+            if (!slot.seq.compare_exchange_strong(cur, sq | kRttClaimed, std::memory_order_acq_rel)) {
+                // Claimed but no longer in rtt_seen_ (a repeat from far back) is still a duplicate.
+                if (cur == (sq | kRttClaimed)) rtt_dups_.fetch_add(1, std::memory_order_relaxed);
+                else rtt_late_.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            const uint64_t sent = slot.sent_ns.load(std::memory_order_acquire);
+            if (slot.seq.load(std::memory_order_acquire) != (sq | kRttClaimed)) {
+                // The sender rearmed the slot while we read it; the time may be the new packet's.
+                rtt_late_.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            rtt_matched_.fetch_add(1, std::memory_order_relaxed);
+            stats_.record_latency(LatencyStage::Rtt, now - sent);
+        }
+        stats_.inc_recv(static_cast<uint64_t>(r));
+        stats_.add_rx_bytes(bytes);
+    }    if (tx_ts_enabled_) collect_tx_timestamps();
+}
+
+// Waits (bounded by --rtt-drain-ms) for echoes of packets still in flight,
+// then stops the receiver.
+void UdpClient::drain_echoes() {
+    const uint64_t deadline = now_ns() + static_cast<uint64_t>(cfg_.rtt_drain_ms) * 1'000'000ull;
+    while (running_ && rtt_matched_.load() + rtt_late_.load() < stats_.sent() && now_ns() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    rx_running_ = false;
+}
+
+void UdpClient::collect_tx_timestamps() {
+    tx_ts_buf_.clear();
+    sock_->read_tx_timestamps(tx_ts_buf_);
+    for (auto& t : tx_ts_buf_) {
+        uint64_t sent = tx_sent_ns_[t.id % kTxRing].load(std::memory_order_acquire);
+        if (sent && t.ts_ns > sent) stats_.record_latency(LatencyStage::TxStack, t.ts_ns - sent);
+    }
 }
 
 void UdpClient::run_loop() {
@@ -51,16 +160,37 @@ void UdpClient::run_loop() {
             std::vector<uint8_t> pkt(std::max(cfg_.payload, (int)sizeof(PacketHeader)), 0);
             PacketHeader* hdr = reinterpret_cast<PacketHeader*>(pkt.data());
             hdr->seq = ++seq_;
-            hdr->send_ts_ns = now_ns();
+            hdr->send_ts_ns = wall_ns();
             hdr->magic = kMagic;
             batch.push_back(std::move(pkt));
         }
+        if (outstanding_) {
+            // Arm before sending so an echo can never beat its slot.
+            const uint64_t t_send = now_ns();
+            for (auto& pkt : batch) {
+                const uint64_t sq = reinterpret_cast<const PacketHeader*>(pkt.data())->seq;
+                Outstanding& slot = outstanding_[sq & (kRttRing - 1)];
+                slot.seq.store(0, std::memory_order_relaxed);
+                slot.sent_ns.store(t_send, std::memory_order_release);
+                slot.seq.store(sq, std::memory_order_release);
+            }
+        }
+        if (tx_ts_enabled_) {
+            // Stamped before sending: the timestamp may be read (by the
+            // receive thread in RTT mode) as soon as the datagram leaves.
+            for (size_t i=0;i<batch.size();i++) {
+                auto* hdr = reinterpret_cast<const PacketHeader*>(batch[i].data());
+                tx_sent_ns_[(tx_id_ + i) % kTxRing].store(hdr->send_ts_ns, std::memory_order_release);
+            }
+        }
         auto s = sock_->send_batch(batch, nullptr);
         if (s > 0) {
             stats_.inc_sent(s);
             size_t total_bytes = 0; for (auto& b: batch) total_bytes += b.size();
             stats_.add_tx_bytes(total_bytes);
+            if (tx_ts_enabled_) tx_id_ += static_cast<uint32_t>(s);
         }
+        if (tx_ts_enabled_ && !cfg_.rtt) collect_tx_timestamps();
 
         // Pace to target pps
         next_ts += interval_ns * cfg_.batch;
@@ -74,10 +204,14 @@ void UdpClient::run_loop() {
         static uint64_t last_print_ns = now_ns();
         if (cfg_.verbose && now - last_print_ns > 1'000'000'000ull) {
             std::cout << "[client " << cfg_.id << "] sent=" << stats_.sent()
-                      << " tx_bytes=" << stats_.tx_bytes() << "\n";
+                      << " tx_bytes=" << stats_.tx_bytes();
+            if (cfg_.rtt) std::cout << " echoed=" << rtt_matched_.load();
+            std::cout << "\n";
             last_print_ns = now;
         }
     }
+    send_seconds_ = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (cfg_.rtt) drain_echoes();
 }
 
 } // namespace udp
@@ -0,0 +1,190 @@
+
+#include "udp/config.hpp"
+#include <fstream>
+#include <sstream>
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <stdexcept>
+
+namespace udp {
+
+static const char* const kValueOptions[] = {
+    "port", "batch", "workers", "proc-threads", "ring-size", "metrics-port", "family", "rcvbuf", "sndbuf", "nic",
+    "batch-min", "batch-max", "latency-target-us", "rcvbuf-max",
+    "client-pps", "client-burst", "global-pps", "global-burst", "rate-table",
+    "flow-table", "flow-idle-ms",
+};
+
+static const char* const kFlagOptions[] = {
+    "pin-workers", "autotune", "echo", "timestamps", "reuseport", "verbose",
+};
+
+// Applied in place by UdpServer::reconfigure().
+static const char* const kReloadableOptions[] = { "workers", "batch" };
+
+bool server_option_takes_value(const std::string& name) {
+    for (const char* o : kValueOptions) if (name == o) return true;
+    return false;
+}
+
+static bool is_flag_option(const std::string& name) {
+    for (const char* o : kFlagOptions) if (name == o) return true;
+    return name == "quiet";  // alias for verbose off
+}
+
+static std::runtime_error bad_value(const std::string& name, const std::string& v, const std::string& expected) {
+    return std::runtime_error("invalid value '" + v + "' for '" + name + "' (expected " + expected + ")");
+}
+
+// A whole decimal integer in [lo, hi]; "abc", "12x" or out-of-range values throw.
+static int64_t to_num(const std::string& name, const std::string& v, int64_t lo, int64_t hi) {
+    errno = 0;
+    char* end = nullptr;
+    const long long n = std::strtoll(v.c_str(), &end, 10);
+    if (v.empty() || *end != '\0' || errno == ERANGE || n < lo || n > hi)
+        throw bad_value(name, v, "an integer in [" + std::to_string(lo) + ", " + std::to_string(hi) + "]");
+    return n;
+}
+
+static int to_int(const std::string& name, const std::string& v, int lo, int hi = INT_MAX) {
+    return static_cast<int>(to_num(name, v, lo, hi));
+}
+
+static uint64_t to_u64(const std::string& name, const std::string& v, uint64_t lo, uint64_t scale = 1) {
+    return static_cast<uint64_t>(to_num(name, v, static_cast<int64_t>(lo), INT64_MAX / static_cast<int64_t>(scale))) * scale;
+}
+
+// Flags are set by name alone; a config file may also say "1"/"true" or "0"/"false".
+static bool to_flag(const std::string& name, const std::string& v) {
+    if (v.empty() || v == "1" || v == "true") return true;
+    if (v == "0" || v == "false") return false;
+    throw bad_value(name, v, "0, 1, true or false");
+}
+
+bool apply_server_option(ServerConfig& cfg, const std::string& name, const std::string& value) {
+    if (name == "port") cfg.port = static_cast<uint16_t>(to_int(name, value, 0, 65535));
+    else if (name == "batch") cfg.batch = to_int(name, value, 1);
+    else if (name == "workers") cfg.workers = to_int(name, value, 1);
+    else if (name == "proc-threads") cfg.proc_threads = to_int(name, value, 0);
+    else if (name == "ring-size") cfg.ring_size = to_u64(name, value, 1);
+    else if (name == "metrics-port") cfg.metrics_port = static_cast<uint16_t>(to_int(name, value, 0, 65535));
+    else if (name == "family") {
+        if (value == "v4") cfg.family = AddressFamily::V4;
+        else if (value == "v6") cfg.family = AddressFamily::V6;
+        else if (value == "dual") cfg.family = AddressFamily::Dual;
+        else throw bad_value(name, value, "v4, v6 or dual");
+    }
+    else if (name == "rcvbuf") cfg.rcvbuf = to_int(name, value, 0);
+    else if (name == "sndbuf") cfg.sndbuf = to_int(name, value, 0);
+    else if (name == "nic") cfg.nic = value;
+    else if (name == "pin-workers") cfg.pin_workers = to_flag(name, value);
+    else if (name == "autotune") cfg.autotune.enabled = to_flag(name, value);
+    else if (name == "batch-min") cfg.autotune.min_batch = to_int(name, value, 1);
+    else if (name == "batch-max") cfg.autotune.max_batch = to_int(name, value, 1);
+    else if (name == "latency-target-us") cfg.autotune.latency_target_ns = to_u64(name, value, 0, 1000);
+    else if (name == "rcvbuf-max") cfg.autotune.max_rcvbuf = to_int(name, value, 0);
+    else if (name == "client-pps") cfg.rate_limit.client_pps = to_u64(name, value, 0);
+    else if (name == "client-burst") cfg.rate_limit.client_burst = to_u64(name, value, 0);
+    else if (name == "global-pps") cfg.rate_limit.global_pps = to_u64(name, value, 0);
+    else if (name == "global-burst") cfg.rate_limit.global_burst = to_u64(name, value, 0);
+    else if (name == "rate-table") cfg.rate_limit.table_size = to_u64(name, value, 1);
+    else if (name == "flow-table") cfg.flows.capacity = to_u64(name, value, 1);
+    else if (name == "flow-idle-ms") cfg.flows.idle_timeout_ns = to_u64(name, value, 0, 1'000'000);
+    else if (name == "echo") cfg.echo = to_flag(name, value);
+    else if (name == "timestamps") cfg.timestamps = to_flag(name, value);
+    else if (name == "reuseport") cfg.reuseport = to_flag(name, value);
+    else if (name == "verbose") cfg.verbose = to_flag(name, value);
+    else if (name == "quiet") cfg.verbose = !to_flag(name, value);
+    else return false;
+    return true;
+}
+
+bool load_server_config(const std::string& path, ServerConfig& cfg, std::string& err) {
+    std::ifstream in(path);
+    if (!in) { err = "cannot open " + path; return false; }
+    std::string line;
+    int lineno = 0;
+    while (std::getline(in, line)) {
+        ++lineno;
+        auto hash = line.find('#');
+        if (hash != std::string::npos) line.erase(hash);
+        for (auto& c : line) if (c == '=') c = ' ';
+        std::istringstream ls(line);
+        std::string name, value, extra;
+        if (!(ls >> name)) continue;
+        ls >> value >> extra;
+        const std::string where = path + ":" + std::to_string(lineno) + ": ";
+        const bool takes_value = server_option_takes_value(name);
+        if (!takes_value && !is_flag_option(name)) { err = where + "unknown option '" + name + "'"; return false; }
+        if (takes_value && value.empty()) { err = where + "option '" + name + "' needs a value"; return false; }
+        if (!extra.empty()) {
+            err = where + "unexpected value after '" + name + "'";
+            return false;
+        }
+        try {
+            apply_server_option(cfg, name, value);
+        } catch (const std::runtime_error& e) {
+            err = where + e.what();
+            return false;
+        }
+    }
+    return true;
+}
+
+static const char* family_name(AddressFamily f) {
+    switch (f) {
+        case AddressFamily::V6: return "v6";
+        case AddressFamily::Dual: return "dual";
+        default: return "v4";
+    }
+}
+
+std::string server_option_value(const ServerConfig& cfg, const std::string& name) {
+    auto s = [](auto v) { return std::to_string(v); };
+    auto flag = [](bool b) { return std::string(b ? "1" : "0"); };
+    if (name == "port") return s(cfg.port);
+    if (name == "batch") return s(cfg.batch);
+    if (name == "workers") return s(cfg.workers);
+    if (name == "proc-threads") return s(cfg.proc_threads);
+    if (name == "ring-size") return s(cfg.ring_size);
+    if (name == "metrics-port") return s(cfg.metrics_port);
+    if (name == "family") return family_name(cfg.family);
+    if (name == "rcvbuf") return s(cfg.rcvbuf);
+    if (name == "sndbuf") return s(cfg.sndbuf);
+    if (name == "nic") return cfg.nic;
+    if (name == "pin-workers") return flag(cfg.pin_workers);
+    if (name == "autotune") return flag(cfg.autotune.enabled);
+    if (name == "batch-min") return s(cfg.autotune.min_batch);
+    if (name == "batch-max") return s(cfg.autotune.max_batch);
+    if (name == "latency-target-us") return s(cfg.autotune.latency_target_ns / 1000);
+    if (name == "rcvbuf-max") return s(cfg.autotune.max_rcvbuf);
+    if (name == "client-pps") return s(cfg.rate_limit.client_pps);
+    if (name == "client-burst") return s(cfg.rate_limit.client_burst);
+    if (name == "global-pps") return s(cfg.rate_limit.global_pps);
+    if (name == "global-burst") return s(cfg.rate_limit.global_burst);
+    if (name == "rate-table") return s(cfg.rate_limit.table_size);
+    if (name == "flow-table") return s(cfg.flows.capacity);
+    if (name == "flow-idle-ms") return s(cfg.flows.idle_timeout_ns / 1'000'000);
+    if (name == "echo") return flag(cfg.echo);
+    if (name == "timestamps") return flag(cfg.timestamps);
+    if (name == "reuseport") return flag(cfg.reuseport);
+    if (name == "verbose") return flag(cfg.verbose);
+    return "";
+}
+
+std::vector<std::string> apply_reloadable(ServerConfig& running, const ServerConfig& loaded) {
+    std::vector<std::string> rejected;
+    auto check = [&](const char* name) {
+        for (const char* r : kReloadableOptions) if (std::string(name) == r) return;
+        if (server_option_value(running, name) != server_option_value(loaded, name)) rejected.push_back(name);
+    };
+    for (const char* o : kValueOptions) check(o);
+    for (const char* o : kFlagOptions) check(o);
+    running.workers = loaded.workers;
+    running.batch = loaded.batch;
+    return rejected;
+}
+
+} // namespace udp
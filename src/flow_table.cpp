@@ -0,0 +1,155 @@
+
+#include "udp/flow_table.hpp"
+
+namespace udp {
+
+static size_t index_size_for(size_t capacity) {
+    size_t n = 2;
+    while (n < capacity * 2) n <<= 1;  // load factor <= 0.5 keeps probes short
+    return n;
+}
+
+FlowTable::FlowTable(const FlowConfig& cfg, uint64_t now_ns, FlowCounters* counters)
+: cfg_(cfg), pool_(cfg.capacity ? cfg.capacity : 1), index_(index_size_for(pool_.size()), kEmpty),
+  index_mask_(index_.size() - 1), wheel_(pool_.size(), cfg.tick_ns, now_ns), counters_(counters) {
+    free_.reserve(pool_.size());
+    for (size_t i = pool_.size(); i-- > 0;) free_.push_back(static_cast<uint32_t>(i));
+}
+
+FlowState* FlowTable::observe(const ClientKey& k, uint32_t bytes, uint64_t seq, uint64_t now_ns) {
+    size_t i = probe_start(k);
+    while (index_[i] != kEmpty && !(pool_[index_[i]].key == k)) i = (i + 1) & index_mask_;
+
+    if (index_[i] == kEmpty) {
+        if (free_.empty()) {
+            if (counters_) counters_->rejected.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        const uint32_t id = free_.back();
+        free_.pop_back();
+        index_[i] = id;
+        FlowState& f = pool_[id];
+        f = FlowState{};
+        f.key = k;
+        f.first_seen_ns = now_ns;
+        f.window_start_ns = now_ns;
+        wheel_.schedule(id, now_ns + cfg_.idle_timeout_ns);
+        ++active_;
+        if (counters_) {
+            counters_->created.fetch_add(1, std::memory_order_relaxed);
+            counters_->active.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    FlowState& f = pool_[index_[i]];
+    f.last_seen_ns = now_ns;
+    ++f.packets;
+    f.bytes += bytes;
+    if (now_ns - f.window_start_ns >= 1'000'000'000ull) {
+        // A window with no packets at all in between means the rate is zero.
+        f.pps = now_ns - f.window_start_ns >= 2'000'000'000ull ? 0 : f.window_packets;
+        f.window_start_ns = now_ns;
+        f.window_packets = 0;
+    }
+    ++f.window_packets;
+    if (seq) track_seq(f, seq);
+    return &f;
+}
+
+void FlowTable::track_seq(FlowState& f, uint64_t seq) {
+    if (f.seq_mask == 0) {
+        // Sequence numbers before the flow's first packet are not ours to count.
+        f.max_seq = seq;
+        f.seq_mask = ~uint64_t(0);
+        return;
+    }
+    uint64_t lost = 0, reordered = 0, dups = 0;
+    if (seq > f.max_seq) {
+        const uint64_t gap = seq - f.max_seq;
+        if (gap >= 64) {
+            // Everything in the window leaves it, plus seqs that never entered.
+            lost = 64 - __builtin_popcountll(f.seq_mask) + (gap - 64);
+            f.seq_mask = 1;
+        } else {
+            const uint64_t leaving = f.seq_mask >> (64 - gap);
+            lost = gap - __builtin_popcountll(leaving);
+            f.seq_mask = (f.seq_mask << gap) | 1;
+        }
+        f.max_seq = seq;
+    } else {
+        const uint64_t off = f.max_seq - seq;
+        if (off >= 64) ++reordered;  // too late: already counted as lost
+        else if ((f.seq_mask >> off) & 1) ++dups;
+        else {
+            f.seq_mask |= uint64_t(1) << off;
+            ++reordered;
+        }
+    }
+    f.lost += lost;
+    f.reordered += reordered;
+    f.duplicates += dups;
+    if (counters_) {
+        if (lost) counters_->lost.fetch_add(lost, std::memory_order_relaxed);
+        if (reordered) counters_->reordered.fetch_add(reordered, std::memory_order_relaxed);
+        if (dups) counters_->duplicates.fetch_add(dups, std::memory_order_relaxed);
+    }
+}
+
+size_t FlowTable::expire(uint64_t now_ns) {
+    size_t expired = 0;
+    wheel_.advance(now_ns, [&](uint32_t id) {
+        const uint64_t deadline = pool_[id].last_seen_ns + cfg_.idle_timeout_ns;
+        if (deadline > now_ns) {
+            wheel_.schedule(id, deadline);  // seen since the timer was armed
+            return;
+        }
+        release(id);
+        ++expired;
+    });
+    if (expired && counters_) counters_->expired.fetch_add(expired, std::memory_order_relaxed);
+    return expired;
+}
+
+// Removes `id` from the index with backward-shift deletion, so linear probing
+// needs no tombstones and lookups stay short under heavy churn.
+void FlowTable::release(uint32_t id) {
+    size_t i = probe_start(pool_[id].key);
+    while (index_[i] != id) i = (i + 1) & index_mask_;
+    size_t j = i;
+    for (;;) {
+        j = (j + 1) & index_mask_;
+        if (index_[j] == kEmpty) break;
+        const size_t h = probe_start(pool_[index_[j]].key);
+        // Entry j may move back to i only if its home slot is not in (i, j].
+        const bool stays = i <= j ? (i < h && h <= j) : (i < h || h <= j);
+        if (!stays) {
+            index_[i] = index_[j];
+            i = j;
+        }
+    }
+    index_[i] = kEmpty;
+    wheel_.cancel(id);
+    free_.push_back(id);
+    --active_;
+    if (counters_) counters_->active.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void FlowTable::clear() {
+    for (size_t i = 0; i < index_.size(); ++i) {
+        if (index_[i] == kEmpty) continue;
+        wheel_.cancel(index_[i]);
+        free_.push_back(index_[i]);
+        index_[i] = kEmpty;
+    }
+    if (counters_) counters_->active.fetch_sub(static_cast<int64_t>(active_), std::memory_order_relaxed);
+    active_ = 0;
+}
+
+const FlowState* FlowTable::find(const ClientKey& k) const {
+    for (size_t i = probe_start(k); index_[i] != kEmpty; i = (i + 1) & index_mask_) {
+        if (pool_[index_[i]].key == k) return &pool_[index_[i]];
+    }
+    return nullptr;
+}
+
+} // namespace udp
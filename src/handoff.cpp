@@ -0,0 +1,155 @@
+
+#include "udp/handoff.hpp"
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace udp {
+
+static sockaddr_un unix_addr(const std::string& path) {
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path))
+        throw std::runtime_error("handoff path too long: " + path);
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    return addr;
+}
+
+HandoffServer::HandoffServer(std::string path, std::vector<int> fds)
+: path_(std::move(path)), fds_(std::move(fds)) {}
+
+HandoffServer::~HandoffServer() { stop(); }
+
+void HandoffServer::start() {
+    sockaddr_un addr = unix_addr(path_);
+    listen_fd_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd_ < 0) throw std::runtime_error("handoff socket() failed: " + std::string(strerror(errno)));
+    // A successor replaces the path while its predecessor is still listening;
+    // the old listener stays reachable only through its already-open fd.
+    ::unlink(path_.c_str());
+    if (::bind(listen_fd_, (sockaddr*)&addr, sizeof(addr)) < 0 || ::listen(listen_fd_, 1) < 0) {
+        int e = errno;
+        ::close(listen_fd_);
+        listen_fd_ = -1;
+        throw std::runtime_error("handoff bind() failed: " + std::string(strerror(e)));
+    }
+    running_ = true;
+    th_ = std::thread(&HandoffServer::run, this);
+}
+
+void HandoffServer::stop() {
+    if (th_.joinable()) {
+        running_ = false;
+        th_.join();
+    }
+    if (listen_fd_ >= 0) {
+        ::close(listen_fd_);
+        listen_fd_ = -1;
+        // After a handoff the path belongs to the successor.
+        if (!handed_off_) ::unlink(path_.c_str());
+    }
+}
+
+void HandoffServer::run() {
+    while (running_ && !handed_off_) {
+        pollfd pfd{listen_fd_, POLLIN, 0};
+        if (::poll(&pfd, 1, 100) <= 0) continue;
+        int c = ::accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+        if (c < 0) continue;
+
+        // Announce the count first so the successor can size its control buffer.
+        char hdr[5] = {'N'};
+        const uint32_t count = static_cast<uint32_t>(fds_.size());
+        std::memcpy(hdr + 1, &count, sizeof(count));
+        if (::send(c, hdr, sizeof(hdr), MSG_NOSIGNAL) != static_cast<ssize_t>(sizeof(hdr))) {
+            ::close(c);
+            continue;
+        }
+        char tag = 'F';
+        iovec iov{&tag, 1};
+        std::vector<char> ctrl(CMSG_SPACE(sizeof(int) * fds_.size()));
+        msghdr mh{};
+        mh.msg_iov = &iov;
+        mh.msg_iovlen = 1;
+        mh.msg_control = ctrl.data();
+        mh.msg_controllen = ctrl.size();
+        cmsghdr* cm = CMSG_FIRSTHDR(&mh);
+        cm->cmsg_level = SOL_SOCKET;
+        cm->cmsg_type = SCM_RIGHTS;
+        cm->cmsg_len = CMSG_LEN(sizeof(int) * fds_.size());
+        std::memcpy(CMSG_DATA(cm), fds_.data(), sizeof(int) * fds_.size());
+
+        if (::sendmsg(c, &mh, MSG_NOSIGNAL) == 1) {
+            // Keep serving until the successor confirms it is reading.
+            timeval tv{5, 0};
+            setsockopt(c, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+            char ack = 0;
+            if (::recv(c, &ack, 1, 0) == 1 && ack == 'R') handed_off_ = true;
+        }
+        ::close(c);
+    }
+}
+
+HandoffClient::HandoffClient(const std::string& path) {
+    sockaddr_un addr = unix_addr(path);
+    fd_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd_ < 0) throw std::runtime_error("handoff socket() failed: " + std::string(strerror(errno)));
+    if (::connect(fd_, (sockaddr*)&addr, sizeof(addr)) < 0) {
+        int e = errno;
+        ::close(fd_);
+        fd_ = -1;
+        throw std::runtime_error("handoff connect(" + path + ") failed: " + std::string(strerror(e)));
+    }
+}
+
+HandoffClient::~HandoffClient() {
+    if (fd_ >= 0) ::close(fd_);
+}
+
+std::vector<int> HandoffClient::receive() {
+    char hdr[5] = {};
+    if (::recv(fd_, hdr, sizeof(hdr), MSG_WAITALL) != static_cast<ssize_t>(sizeof(hdr)) || hdr[0] != 'N')
+        throw std::runtime_error("handoff receive failed");
+    uint32_t count = 0;
+    std::memcpy(&count, hdr + 1, sizeof(count));
+    if (count == 0 || count > 4096) throw std::runtime_error("handoff announced " + std::to_string(count) + " fds");
+    char tag = 0;
+    iovec iov{&tag, 1};
+    std::vector<char> ctrl(CMSG_SPACE(sizeof(int) * count));
+    msghdr mh{};
+    mh.msg_iov = &iov;
+    mh.msg_iovlen = 1;
+    mh.msg_control = ctrl.data();
+    mh.msg_controllen = ctrl.size();
+    if (::recvmsg(fd_, &mh, MSG_CMSG_CLOEXEC) != 1 || tag != 'F')
+        throw std::runtime_error("handoff receive failed");
+    std::vector<int> fds;
+    for (cmsghdr* c = CMSG_FIRSTHDR(&mh); c; c = CMSG_NXTHDR(&mh, c)) {
+        if (c->cmsg_level != SOL_SOCKET || c->cmsg_type != SCM_RIGHTS) continue;
+        size_t n = (c->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        size_t off = fds.size();
+        fds.resize(off + n);
+        std::memcpy(fds.data() + off, CMSG_DATA(c), n * sizeof(int));
+    }
+    if ((mh.msg_flags & MSG_CTRUNC) || fds.size() != count) {
+        // A partial reuseport group would leave some flows unread.
+        for (int fd : fds) ::close(fd);
+        throw std::runtime_error("handoff expected " + std::to_string(count) + " fds, received "
+                                 + std::to_string(fds.size()) + ((mh.msg_flags & MSG_CTRUNC) ? " (truncated)" : ""));
+    }
+    return fds;
+}
+
+void HandoffClient::ack() {
+    char ack = 'R';
+    if (::send(fd_, &ack, 1, MSG_NOSIGNAL) != 1)
+        throw std::runtime_error("handoff ack failed: " + std::string(strerror(errno)));
+}
+
+} // namespace udp
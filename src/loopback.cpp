@@ -0,0 +1,156 @@
+
+#include "udp/loopback.hpp"
+#include "udp/common.hpp"
+#include <arpa/inet.h>
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+namespace udp {
+
+LoopbackChannel::LoopbackChannel(const LinkImpairment& imp, size_t ring_size)
+: imp_(imp), data_(ring_size), free_(ring_size), rng_(imp.seed) {}
+
+// splitmix64: tiny, fast, and identical on every platform for a given seed.
+uint64_t LoopbackChannel::next() {
+    uint64_t z = (rng_ += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+LoopbackChannel::Frame LoopbackChannel::make_frame(const std::vector<uint8_t>& buf,
+                                                   const SockAddr& from, uint64_t due) {
+    Frame f;
+    free_.try_pop(f);  // reuse a returned buffer's capacity when there is one
+    f.data.assign(buf.begin(), buf.end());
+    f.from = from;
+    f.due_ns = due;
+    return f;
+}
+
+void LoopbackChannel::enqueue(Frame&& f) {
+    // The frame is only moved on success; on overflow it is simply released.
+    if (!data_.try_push(std::move(f))) overflowed_.fetch_add(1, std::memory_order_relaxed);
+}
+
+size_t LoopbackChannel::send(const std::vector<std::vector<uint8_t>>& bufs, const SockAddr& from) {
+    std::lock_guard<std::mutex> lg(tx_mu_);
+    const uint64_t base = wall_ns() + imp_.delay_ns;
+    uint64_t lost = 0, dups = 0, reordered = 0;
+    for (const auto& b : bufs) {
+        if (imp_.loss > 0 && uniform() < imp_.loss) { ++lost; continue; }
+        const uint64_t due = base + (imp_.jitter_ns ? next() % imp_.jitter_ns : 0);
+        if (imp_.duplicate > 0 && uniform() < imp_.duplicate) {
+            enqueue(make_frame(b, from, due));
+            ++dups;
+        }
+        Frame f = make_frame(b, from, due);
+        if (!has_held_ && imp_.reorder > 0 && uniform() < imp_.reorder) {
+            held_ = std::move(f);
+            has_held_ = true;
+            continue;
+        }
+        enqueue(std::move(f));
+        if (has_held_) {
+            // Counted here, once it actually lands behind a newer datagram.
+            enqueue(std::move(held_));
+            has_held_ = false;
+            ++reordered;
+        }
+    }
+    sent_.fetch_add(bufs.size(), std::memory_order_relaxed);
+    if (lost) lost_.fetch_add(lost, std::memory_order_relaxed);
+    if (dups) duplicated_.fetch_add(dups, std::memory_order_relaxed);
+    if (reordered) reordered_.fetch_add(reordered, std::memory_order_relaxed);
+    return bufs.size();
+}
+
+// Receiver side, with the ring empty: a frame held back for reordering has
+// nothing left to wait behind, so it is delivered in order rather than never
+// (e.g. the last datagram of a run). Caller holds rx_mu_.
+bool LoopbackChannel::take_held() {
+    if (!has_held_.load(std::memory_order_relaxed)) return false;
+    std::lock_guard<std::mutex> lg(tx_mu_);
+    if (!has_held_) return false;
+    head_ = std::move(held_);
+    has_held_ = false;
+    return true;
+}
+
+size_t LoopbackChannel::recv(std::vector<std::vector<uint8_t>>& bufs, std::vector<PacketMeta>* meta,
+                             bool rx_ts) {
+    std::lock_guard<std::mutex> lg(rx_mu_);
+    if (meta && meta->size() < bufs.size()) meta->resize(bufs.size());
+    const bool delayed = imp_.delay_ns || imp_.jitter_ns;
+    const uint64_t now = delayed ? wall_ns() : 0;
+    size_t n = 0;
+    while (n < bufs.size()) {
+        if (!has_head_) {
+            if (!data_.try_pop(head_) && !take_held()) break;
+            has_head_ = true;
+        }
+        if (delayed && head_.due_ns > now) break;
+        auto& dst = bufs[n];
+        const size_t len = std::min(dst.size(), head_.data.size());
+        std::memcpy(dst.data(), head_.data.data(), len);
+        if (meta) {
+            (*meta)[n].peer = head_.from;
+            (*meta)[n].len = static_cast<uint32_t>(len);
+            (*meta)[n].rx_ts_ns = rx_ts ? head_.due_ns : 0;
+        }
+        free_.try_push(std::move(head_));
+        has_head_ = false;
+        ++n;
+    }
+    if (n) delivered_.fetch_add(n, std::memory_order_relaxed);
+    return n;
+}
+
+LoopbackSocket::LoopbackSocket(std::shared_ptr<LoopbackChannel> tx, std::shared_ptr<LoopbackChannel> rx,
+                               const SockAddr& local)
+: tx_(std::move(tx)), rx_(std::move(rx)), local_(local) {}
+
+void LoopbackSocket::bind(uint16_t port, bool reuseport) {
+    (void)reuseport;
+    if (local_.family() == AF_INET6) local_.v6.sin6_port = htons(port);
+    else local_.v4.sin_port = htons(port);
+    bound_ = true;
+}
+
+void LoopbackSocket::connect(const std::string& ip, uint16_t port) {
+    // The peer is fixed by the pair; nothing to resolve.
+    (void)ip; (void)port;
+}
+
+ssize_t LoopbackSocket::recv_batch(std::vector<std::vector<uint8_t>>& bufs, std::vector<PacketMeta>* meta) {
+    size_t n = rx_->recv(bufs, meta, rx_timestamps_);
+    // Mirror a blocking socket loosely: give the sender the core when idle.
+    if (n == 0) std::this_thread::yield();
+    return static_cast<ssize_t>(n);
+}
+
+ssize_t LoopbackSocket::send_batch(const std::vector<std::vector<uint8_t>>& bufs,
+                                   const std::vector<PacketMeta>* meta) {
+    (void)meta;  // single peer
+    return static_cast<ssize_t>(tx_->send(bufs, local_));
+}
+
+bool LoopbackSocket::enable_timestamps(bool rx, bool tx) {
+    rx_timestamps_ = rx;
+    return !tx;
+}
+
+LoopbackPair make_loopback_pair(const LinkImpairment& a_to_b, const LinkImpairment& b_to_a, size_t ring_size) {
+    LoopbackPair p;
+    p.a_to_b = std::make_shared<LoopbackChannel>(a_to_b, ring_size);
+    p.b_to_a = std::make_shared<LoopbackChannel>(b_to_a, ring_size);
+    SockAddr addr_a, addr_b;
+    parse_address("127.0.0.1", 40000, addr_a);
+    parse_address("127.0.0.1", 9000, addr_b);
+    p.a = std::make_unique<LoopbackSocket>(p.a_to_b, p.b_to_a, addr_a);
+    p.b = std::make_unique<LoopbackSocket>(p.b_to_a, p.a_to_b, addr_b);
+    return p;
+}
+
+} // namespace udp
@@ -16,18 +16,44 @@ int main(int argc, char** argv) {
         else if (!strcmp(argv[i],"--payload") && i+1<argc) cfg.payload = atoi(argv[++i]);
         else if (!strcmp(argv[i],"--batch") && i+1<argc) cfg.batch = atoi(argv[++i]);
         else if (!strcmp(argv[i],"--id") && i+1<argc) cfg.id = atoi(argv[++i]);
+        else if (!strcmp(argv[i],"--sndbuf") && i+1<argc) cfg.sndbuf = atoi(argv[++i]);
+        else if (!strcmp(argv[i],"--rcvbuf") && i+1<argc) cfg.rcvbuf = atoi(argv[++i]);
         else if (!strcmp(argv[i],"--verbose")) cfg.verbose = true;
+        else if (!strcmp(argv[i],"--tx-timestamps")) cfg.tx_timestamps = true;
+        else if (!strcmp(argv[i],"--rtt")) cfg.rtt = true;
+        else if (!strcmp(argv[i],"--rtt-drain-ms") && i+1<argc) cfg.rtt_drain_ms = atoi(argv[++i]);
         else if (!strcmp(argv[i],"--help")) {
-            std::cout << "udp_client --server <ip> --port <p> --pps <n> --seconds <n> --payload <n> --batch <n> --id <n> [--verbose]\n";
+            std::cout << "udp_client --server <ip> --port <p> --pps <n> --seconds <n> --payload <n> --batch <n> --id <n> [--sndbuf <bytes>] [--rcvbuf <bytes>] [--verbose] [--tx-timestamps] [--rtt [--rtt-drain-ms <n>]]\n";
             return 0;
         }
     }
     try {
-        auto sock = std::make_unique<UdpSocket>(cfg.batch);
+        // Numeric IPv6 literals always contain ':'; pick the socket family to match.
+        auto family = cfg.server_ip.find(':') != std::string::npos ? AddressFamily::V6 : AddressFamily::V4;
+        auto sock = std::make_unique<UdpSocket>(cfg.batch, family);
         UdpClient client(std::move(sock), cfg);
         client.start();
         // Wait for the client run loop to finish based on --seconds.
         client.join();
+        const auto& tx = client.stats().latency(LatencyStage::TxStack);
+        if (tx.count()) {
+            std::cout << "[client " << cfg.id << "] tx_stack_ns p50=" << tx.percentile(0.5)
+                      << " p99=" << tx.percentile(0.99) << " samples=" << tx.count() << "\n";
+        }
+        if (cfg.rtt) {
+            const RttReport r = client.rtt_report();
+            std::cout << "[client " << cfg.id << "] rtt sent=" << r.sent << " received=" << r.received
+                      << " lost=" << r.lost() << " (" << r.loss_ratio() * 100.0 << "%)"
+                      << " dup=" << r.duplicates << " late=" << r.late
+                      << " client_rx_dropped=" << r.client_rx_dropped
+                      << " rate=" << human_rate(r.achieved_pps()) << "\n";
+            const auto& rtt = client.stats().latency(LatencyStage::Rtt);
+            if (rtt.count()) {
+                std::cout << "[client " << cfg.id << "] rtt_ns p50=" << rtt.percentile(0.5)
+                          << " p90=" << rtt.percentile(0.9) << " p99=" << rtt.percentile(0.99)
+                          << " p999=" << rtt.percentile(0.999) << " max=" << rtt.percentile(1.0) << "\n";
+            }
+        }
         return 0;
     } catch (const std::exception& e) {
         std::cerr << "Client error: " << e.what() << "\n";
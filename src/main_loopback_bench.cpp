@@ -0,0 +1,85 @@
+#include "udp/client.hpp"
+#include "udp/server.hpp"
+#include "udp/loopback.hpp"
+#include <iostream>
+#include <cstring>
+#include <thread>
+
+using namespace udp;
+
+// Runs a UdpClient and a UdpServer in one process over a LoopbackSocket pair,
+// so the reported cost per packet is the application's alone (no syscalls).
+int main(int argc, char** argv) {
+    ClientConfig ccfg;
+    ccfg.pps = 50'000'000;  // effectively unpaced
+    ccfg.seconds = 3;
+    ServerConfig scfg;
+    scfg.metrics_port = 0;
+    scfg.verbose = false;
+    LinkImpairment imp;
+    size_t ring = 1 << 16;
+    for (int i=1;i<argc;i++){
+        if (!strcmp(argv[i],"--pps") && i+1<argc) ccfg.pps = (uint64_t)atoll(argv[++i]);
+        else if (!strcmp(argv[i],"--seconds") && i+1<argc) ccfg.seconds = atoi(argv[++i]);
+        else if (!strcmp(argv[i],"--payload") && i+1<argc) ccfg.payload = atoi(argv[++i]);
+        else if (!strcmp(argv[i],"--batch") && i+1<argc) ccfg.batch = scfg.batch = atoi(argv[++i]);
+        else if (!strcmp(argv[i],"--workers") && i+1<argc) scfg.workers = atoi(argv[++i]);
+        else if (!strcmp(argv[i],"--proc-threads") && i+1<argc) scfg.proc_threads = atoi(argv[++i]);
+        else if (!strcmp(argv[i],"--ring") && i+1<argc) ring = (size_t)atoll(argv[++i]);
+        else if (!strcmp(argv[i],"--loss") && i+1<argc) imp.loss = atof(argv[++i]);
+        else if (!strcmp(argv[i],"--dup") && i+1<argc) imp.duplicate = atof(argv[++i]);
+        else if (!strcmp(argv[i],"--reorder") && i+1<argc) imp.reorder = atof(argv[++i]);
+        else if (!strcmp(argv[i],"--delay-us") && i+1<argc) imp.delay_ns = (uint64_t)atoll(argv[++i]) * 1000;
+        else if (!strcmp(argv[i],"--jitter-us") && i+1<argc) imp.jitter_ns = (uint64_t)atoll(argv[++i]) * 1000;
+        else if (!strcmp(argv[i],"--seed") && i+1<argc) imp.seed = (uint64_t)atoll(argv[++i]);
+        else if (!strcmp(argv[i],"--echo")) scfg.echo = true;
+        else if (!strcmp(argv[i],"--timestamps")) scfg.timestamps = true;
+        else if (!strcmp(argv[i],"--help")) {
+            std::cout << "udp_loopback_bench [--pps <n>] [--seconds <n>] [--payload <n>] [--batch <n>] [--workers <n>]\n"
+                         "                   [--proc-threads <n>] [--ring <n>] [--echo] [--timestamps]\n"
+                         "                   [--loss <p>] [--dup <p>] [--reorder <p>] [--delay-us <n>] [--jitter-us <n>] [--seed <n>]\n";
+            return 0;
+        }
+    }
+    try {
+        auto link = make_loopback_pair(imp, {}, ring);
+        auto a_to_b = link.a_to_b;
+        UdpServer server(std::move(link.b), scfg);
+        UdpClient client(std::move(link.a), ccfg);
+        server.start();
+        uint64_t t0 = now_ns();
+        client.start();
+        client.join();
+        // Let the server drain what is still queued on the link. The clock stops
+        // at the last poll that saw progress, so the 20 ms idle check that ends
+        // the drain is not billed to the packets.
+        uint64_t last = server.stats().recv();
+        uint64_t t_end = now_ns();
+        for (uint64_t idle_since = t_end; now_ns() - idle_since < 20'000'000;) {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+            const uint64_t r = server.stats().recv();
+            if (r != last) {
+                last = r;
+                t_end = idle_since = now_ns();
+            }
+        }
+        uint64_t elapsed = t_end - t0;
+        server.stop();
+
+        const uint64_t recv = server.stats().recv();
+        std::cout << "sent=" << client.stats().sent() << " recv=" << recv
+                  << " lost=" << a_to_b->lost() << " dup=" << a_to_b->duplicated()
+                  << " reordered=" << a_to_b->reordered() << " overflow=" << a_to_b->overflowed() << "\n";
+        std::cout << "rate=" << human_rate(recv * 1e9 / elapsed);
+        if (recv) std::cout << " ns_per_packet=" << static_cast<double>(elapsed) / recv;
+        std::cout << "\n";
+        const auto& proc = server.stats().latency(LatencyStage::Processing);
+        if (proc.count()) {
+            std::cout << "processing_ns p50=" << proc.percentile(0.5) << " p99=" << proc.percentile(0.99) << "\n";
+        }
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "Bench error: " << e.what() << "\n";
+        return 1;
+    }
+}
@@ -1,7 +1,10 @@
 #include "udp/server.hpp"
 #include "udp/socket.hpp"
+#include "udp/config.hpp"
+#include "udp/handoff.hpp"
 #include <iostream>
 #include <cstring>
+#include <cstdlib>
 #include <thread>
 #include <chrono>
 #include <atomic>
@@ -9,41 +12,141 @@
 
 using namespace udp;
 
-// Global flag toggled by signal handlers to stop the server gracefully.
+// Global flags toggled by signal handlers: stop gracefully, or reload the config file.
 static std::atomic<bool> g_keepRunning{true};
+static std::atomic<bool> g_reload{false};
 
 static void handle_signal(int) {
     g_keepRunning = false;
 }
 
+static void handle_reload(int) {
+    g_reload = true;
+}
+
+static void usage() {
+    std::cout << "udp_server --port <p> --batch <n> --workers <n> [--proc-threads <n> --ring-size <n>] --metrics-port <p> [--family v4|v6|dual] [--echo] [--timestamps] [--reuseport] [--verbose|--quiet]\n"
+                 "           [--rcvbuf <bytes>] [--sndbuf <bytes>] [--autotune] [--batch-min <n>] [--batch-max <n>]\n"
+                 "           [--latency-target-us <n>] [--rcvbuf-max <bytes>] [--pin-workers] [--nic <ifname>]\n"
+                 "           [--client-pps <n>] [--client-burst <n>] [--global-pps <n>] [--global-burst <n>] [--rate-table <n>]\n"
+                 "           [--flow-table <n>] [--flow-idle-ms <n>]\n"
+                 "           [--config <file>] [--handoff-path <unix socket>] [--takeover]\n";
+}
+
 int main(int argc, char** argv) {
     ServerConfig cfg;
+    std::string config_path, handoff_path;
+    bool takeover = false;
     for (int i = 1; i < argc; i++) {
-        if (!std::strcmp(argv[i], "--port") && i + 1 < argc) cfg.port = static_cast<uint16_t>(std::atoi(argv[++i]));
-        else if (!std::strcmp(argv[i], "--batch") && i + 1 < argc) cfg.batch = std::atoi(argv[++i]);
-        else if (!std::strcmp(argv[i], "--metrics-port") && i + 1 < argc) cfg.metrics_port = static_cast<uint16_t>(std::atoi(argv[++i]));
-        else if (!std::strcmp(argv[i], "--echo")) cfg.echo = true;
-        else if (!std::strcmp(argv[i], "--reuseport")) cfg.reuseport = true;
-        else if (!std::strcmp(argv[i], "--verbose")) cfg.verbose = true;
-        else if (!std::strcmp(argv[i], "--quiet")) cfg.verbose = false;
-        else if (!std::strcmp(argv[i], "--help")) {
-            std::cout << "udp_server --port <p> --batch <n> --metrics-port <p> [--echo] [--reuseport] [--verbose|--quiet]\n";
-            return 0;
+        if (!std::strcmp(argv[i], "--help")) { usage(); return 0; }
+        if (!std::strcmp(argv[i], "--config") && i + 1 < argc) {
+            config_path = argv[++i];
+            std::string err;
+            if (!load_server_config(config_path, cfg, err)) { std::cerr << "Server error: " << err << "\n"; return 1; }
+            continue;
+        }
+        if (!std::strcmp(argv[i], "--handoff-path") && i + 1 < argc) { handoff_path = argv[++i]; continue; }
+        if (!std::strcmp(argv[i], "--takeover")) { takeover = true; continue; }
+        std::string name = std::strncmp(argv[i], "--", 2) == 0 ? argv[i] + 2 : "";
+        std::string error;
+        if (server_option_takes_value(name)) {
+            if (i + 1 >= argc) {
+                error = "missing value for ";
+            } else {
+                try {
+                    apply_server_option(cfg, name, argv[++i]);
+                } catch (const std::runtime_error& e) {
+                    std::cerr << "Server error: " << e.what() << "\n";
+                    usage();
+                    return 1;
+                }
+            }
+        } else if (name.empty() || !apply_server_option(cfg, name, "")) {
+            error = "unknown option ";
+        }
+        if (!error.empty()) {
+            std::cerr << "Server error: " << error << argv[i] << "\n";
+            usage();
+            return 1;
         }
     }
 
+    // With a config file, SIGHUP may add workers later; each needs its own
+    // member of a reuseport group.
+    cfg.reloadable = !config_path.empty();
     try {
-        auto sock = std::make_unique<UdpSocket>(cfg.batch);
+        std::unique_ptr<UdpSocket> sock;
+        std::vector<std::unique_ptr<ISocket>> siblings;
+        std::unique_ptr<HandoffClient> predecessor;
+        if (takeover) {
+            if (handoff_path.empty()) throw std::runtime_error("--takeover requires --handoff-path");
+            predecessor = std::make_unique<HandoffClient>(handoff_path);
+            auto fds = predecessor->receive();
+            // The predecessor's per-worker sockets: keep reading all of them so
+            // no flow's queue is orphaned.
+            sock = UdpSocket::adopt(fds[0], cfg.batch);
+            for (size_t i = 1; i < fds.size(); ++i) siblings.push_back(UdpSocket::adopt(fds[i], cfg.batch));
+        } else {
+            sock = std::make_unique<UdpSocket>(cfg.batch, cfg.family);
+        }
         UdpServer server(std::move(sock), cfg);
+        server.add_sockets(std::move(siblings));
         server.start();
+        if (predecessor) {
+            // We are reading now; the predecessor can stop and exit.
+            predecessor->ack();
+            predecessor.reset();
+            if (cfg.verbose) std::cout << "[server] took over UDP socket from predecessor\n";
+        }
 
-        // Register signal handlers, then idle until a termination signal arrives.
+        std::unique_ptr<HandoffServer> handoff;
+        if (!handoff_path.empty()) {
+            handoff = std::make_unique<HandoffServer>(handoff_path, server.socket_fds());
+            handoff->start();
+        }
+
+        // Register signal handlers, then idle until a termination signal arrives
+        // or a successor takes the socket over.
         std::signal(SIGINT,  handle_signal);
         std::signal(SIGTERM, handle_signal);
-        while (g_keepRunning) {
-            std::this_thread::sleep_for(std::chrono::seconds(1));
+        std::signal(SIGHUP,  handle_reload);
+        while (g_keepRunning && !(handoff && handoff->handed_off())) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            if (g_reload.exchange(false)) {
+                ServerConfig next = cfg;
+                std::string err;
+                if (config_path.empty()) {
+                    std::cerr << "[server] SIGHUP ignored: no --config file\n";
+                } else if (!load_server_config(config_path, next, err)) {
+                    std::cerr << "[server] reload failed: " << err << "\n";
+                } else {
+                    // Only workers and batch change in place; anything else
+                    // keeps its running value until a restart.
+                    for (const auto& name : apply_reloadable(cfg, next)) {
+                        std::cerr << "[server] reload: '" << name << "' cannot change at runtime, keeping "
+                                  << server_option_value(cfg, name) << " (restart to apply "
+                                  << server_option_value(next, name) << ")\n";
+                    }
+                    if (!server.reconfigure(cfg)) {
+                        std::cerr << "[server] reload: 'workers' cannot grow to " << cfg.workers
+                                  << ": the UDP socket is not in an SO_REUSEPORT group, keeping "
+                                  << server.worker_count() << " (restart with --reuseport)\n";
+                        cfg.workers = static_cast<int>(server.worker_count());
+                    }
+                    if (handoff) {
+                        // The worker count decides which sockets a successor must inherit.
+                        handoff->stop();
+                        handoff = std::make_unique<HandoffServer>(handoff_path, server.socket_fds());
+                        handoff->start();
+                    }
+                }
+            }
+        }
+        if (handoff && handoff->handed_off() && cfg.verbose) {
+            std::cout << "[server] socket handed off, draining workers\n";
         }
         server.stop();
+        if (handoff) handoff->stop();
         return 0;
     } catch (const std::exception& e) {
         std::cerr << "Server error: " << e.what() << "\n";
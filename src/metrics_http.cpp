@@ -3,6 +3,7 @@
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
+#include <poll.h>
 #include <unistd.h>
 #include <cstring>
 #include <sstream>
@@ -29,6 +30,11 @@ void MetricsHttpServer::stop() {
     }
 }
 
+void MetricsHttpServer::add_collector(Collector c) {
+    std::lock_guard<std::mutex> lg(collectors_mu_);
+    collectors_.push_back(std::move(c));
+}
+
 std::string MetricsHttpServer::render() {
     std::ostringstream oss;
     oss << "# HELP udp_packets_received_total Total UDP packets received\n";
@@ -37,7 +43,7 @@ std::string MetricsHttpServer::render() {
     oss << "# HELP udp_packets_sent_total Total UDP packets sent\n";
     oss << "# TYPE udp_packets_sent_total counter\n";
     oss << "udp_packets_sent_total " << stats_.sent() << "\n";
-    oss << "# HELP udp_unique_clients Unique client count\n";
+    oss << "# HELP udp_unique_clients Distinct clients (address and port) seen since start, estimated\n";
     oss << "# TYPE udp_unique_clients gauge\n";
     oss << "udp_unique_clients " << stats_.unique_clients() << "\n";
     oss << "# HELP udp_rx_bytes_total Total received bytes\n";
@@ -46,6 +52,44 @@ std::string MetricsHttpServer::render() {
     oss << "# HELP udp_tx_bytes_total Total sent bytes\n";
     oss << "# TYPE udp_tx_bytes_total counter\n";
     oss << "udp_tx_bytes_total " << stats_.tx_bytes() << "\n";
+    const auto& fl = stats_.flows();
+    oss << "# HELP udp_flows_active Flows currently tracked by the flow tables\n";
+    oss << "# TYPE udp_flows_active gauge\n";
+    oss << "udp_flows_active " << fl.active.load() << "\n";
+    oss << "# HELP udp_flows_total Flow table events: created, expired (idle) or rejected (table full)\n";
+    oss << "# TYPE udp_flows_total counter\n";
+    oss << "udp_flows_total{event=\"created\"} " << fl.created.load() << "\n";
+    oss << "udp_flows_total{event=\"expired\"} " << fl.expired.load() << "\n";
+    oss << "udp_flows_total{event=\"rejected\"} " << fl.rejected.load() << "\n";
+    oss << "# HELP udp_flow_sequence_anomalies_total Per-flow sequence tracking: lost, reordered, duplicate\n";
+    oss << "# TYPE udp_flow_sequence_anomalies_total counter\n";
+    oss << "udp_flow_sequence_anomalies_total{kind=\"lost\"} " << fl.lost.load() << "\n";
+    oss << "udp_flow_sequence_anomalies_total{kind=\"reordered\"} " << fl.reordered.load() << "\n";
+    oss << "udp_flow_sequence_anomalies_total{kind=\"duplicate\"} " << fl.duplicates.load() << "\n";
+    oss << "# HELP udp_packets_dropped_total Packets dropped before processing, by reason\n";
+    oss << "# TYPE udp_packets_dropped_total counter\n";
+    for (size_t i = 0; i < static_cast<size_t>(DropReason::Count); ++i) {
+        auto r = static_cast<DropReason>(i);
+        oss << "udp_packets_dropped_total{reason=\"" << drop_reason_name(r) << "\"} "
+            << stats_.dropped(r) << "\n";
+    }
+    oss << "# HELP udp_latency_seconds Per-packet latency split by stage (kernel timestamps)\n";
+    oss << "# TYPE udp_latency_seconds summary\n";
+    static const double kQuantiles[] = {0.5, 0.9, 0.99, 0.999};
+    for (size_t i = 0; i < static_cast<size_t>(LatencyStage::Count); ++i) {
+        auto st = static_cast<LatencyStage>(i);
+        const auto& h = stats_.latency(st);
+        if (h.count() == 0) continue;
+        const char* name = latency_stage_name(st);
+        for (double q : kQuantiles) {
+            oss << "udp_latency_seconds{stage=\"" << name << "\",quantile=\"" << q << "\"} "
+                << static_cast<double>(h.percentile(q)) / 1e9 << "\n";
+        }
+        oss << "udp_latency_seconds_sum{stage=\"" << name << "\"} " << static_cast<double>(h.sum()) / 1e9 << "\n";
+        oss << "udp_latency_seconds_count{stage=\"" << name << "\"} " << h.count() << "\n";
+    }
+    std::lock_guard<std::mutex> lg(collectors_mu_);
+    for (auto& c : collectors_) c(oss);
     return oss.str();
 }
 
@@ -63,6 +107,9 @@ void MetricsHttpServer::run() {
     bind(s, (sockaddr*)&addr, sizeof(addr));
     listen(s, 8);
     while (running_) {
+        // Wake up regularly so stop() never waits on a scrape that never comes.
+        pollfd pfd{s, POLLIN, 0};
+        if (::poll(&pfd, 1, 100) <= 0) continue;
         sockaddr_in peer{};
         socklen_t plen=sizeof(peer);
         int c = accept(s, (sockaddr*)&peer, &plen);
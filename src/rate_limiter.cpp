@@ -0,0 +1,72 @@
+
+#include "udp/rate_limiter.hpp"
+#include <algorithm>
+
+namespace udp {
+
+static size_t round_pow2(size_t n) {
+    size_t p = 1;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+// Emission interval T and burst tolerance tau for a GCRA bucket.
+static void gcra_params(uint64_t pps, uint64_t burst, uint64_t& interval, uint64_t& tolerance) {
+    if (pps == 0) { interval = 0; tolerance = 0; return; }
+    interval = std::max<uint64_t>(1, 1'000'000'000ull / pps);
+    if (burst == 0) burst = pps;
+    tolerance = interval * (burst - 1);
+}
+
+RateLimiter::RateLimiter(const RateLimitConfig& cfg)
+: table_(round_pow2(std::max<size_t>(cfg.table_size, kMaxProbe)), Entry{0, 0}),
+  mask_(table_.size() - 1) {
+    gcra_params(cfg.client_pps, cfg.client_burst, client_interval_ns_, client_tolerance_ns_);
+    gcra_params(cfg.global_pps, cfg.global_burst, global_interval_ns_, global_tolerance_ns_);
+}
+
+RateLimiter::Entry& RateLimiter::lookup(uint64_t key, uint64_t now_ns) {
+    // Keys are already well-mixed fingerprints, so the low bits index directly.
+    size_t idx = key & mask_;
+    Entry* victim = nullptr;
+    for (size_t p = 0; p < kMaxProbe; ++p) {
+        Entry& e = table_[(idx + p) & mask_];
+        if (!e.key) {
+            e = Entry{0, key};
+            ++tracked_;
+            return e;
+        }
+        if (e.key == key) return e;
+        if (!victim || e.tat < victim->tat) victim = &e;
+    }
+    if (victim->tat > now_ns) {
+        // Every bucket in the window still holds a debt; keep them all.
+        ++overflowed_;
+        return overflow_;
+    }
+    ++evictions_;
+    *victim = Entry{0, key};
+    return *victim;
+}
+
+RateLimiter::Verdict RateLimiter::admit(uint64_t addr_key, uint64_t now_ns) {
+    uint64_t client_tat = 0;
+    Entry* e = nullptr;
+    if (client_interval_ns_) {
+        e = &lookup(addr_key, now_ns);
+        uint64_t tat = std::max(e->tat, now_ns);
+        if (tat - now_ns > client_tolerance_ns_) return Verdict::ClientLimited;
+        client_tat = tat + client_interval_ns_;
+    }
+    if (global_interval_ns_) {
+        uint64_t tat = std::max(global_tat_, now_ns);
+        if (tat - now_ns > global_tolerance_ns_) return Verdict::GlobalLimited;
+        global_tat_ = tat + global_interval_ns_;
+    }
+    // Commit the per-source charge only once the global ceiling has admitted
+    // the packet, so globally shed traffic does not eat into client budgets.
+    if (e) e->tat = client_tat;
+    return Verdict::Admit;
+}
+
+} // namespace udp
@@ -1,18 +1,44 @@
 
 #include "udp/server.hpp"
 #include <iostream>
+#include <algorithm>
 #include <cstring>
 #include <arpa/inet.h>
+#include <sched.h>
 
 namespace udp {
 
 UdpServer::UdpServer(std::unique_ptr<ISocket> sock, ServerConfig cfg)
-: sock_(std::move(sock)), cfg_(cfg) {
-    sock_->bind(cfg_.port, cfg_.reuseport);
-    sock_->set_rcvbuf(1<<20);
-    sock_->set_sndbuf(1<<20);
+: sock_(std::move(sock)), cfg_(cfg), limiter_(cfg_.rate_limit) {
+    // More than one worker (now or after a reload) needs a reuseport group so
+    // each can own a socket.
+    if (!sock_->bound()) sock_->bind(cfg_.port, cfg_.reuseport || cfg_.workers > 1 || cfg_.reloadable);
+    sock_->set_rcvbuf(cfg_.rcvbuf);
+    sock_->set_sndbuf(cfg_.sndbuf);
+    rcvbuf_bytes_ = sock_->rcvbuf();
+    if (ISocket::buffer_capped(cfg_.rcvbuf, rcvbuf_bytes_) && cfg_.verbose) {
+        std::cerr << "[server] SO_RCVBUF capped at " << rcvbuf_bytes_ / 2 << " bytes (requested "
+                  << cfg_.rcvbuf << "); raise net.core.rmem_max or grant CAP_NET_ADMIN\n";
+    }
+    batch_now_ = cfg_.batch;
+    batch_target_ = cfg_.batch;
+    if (cfg_.timestamps && !sock_->enable_timestamps(true, false)) {
+        std::cerr << "[server] kernel RX timestamps unavailable, latency breakdown disabled\n";
+        cfg_.timestamps = false;
+    }
+    topo_ = Topology::discover();
+    allowed_cpus_ = allowed_cpus();
+    if (!cfg_.nic.empty()) {
+        home_node_ = nic_numa_node(cfg_.nic);
+        irqs_ = nic_irqs(cfg_.nic);
+        if (cfg_.verbose) report_irqs();
+    }
     if (cfg_.metrics_port) {
         metrics_ = std::make_unique<MetricsHttpServer>(stats_, cfg_.metrics_port);
+        metrics_->add_collector([this](std::ostream& os) { render_tuning(os); });
+        metrics_->add_collector([this](std::ostream& os) { render_placement(os); });
+        if (cfg_.proc_threads > 0)
+            metrics_->add_collector([this](std::ostream& os) { render_staging(os); });
     }
 }
 
@@ -23,52 +49,474 @@ UdpServer::~UdpServer() {
 void UdpServer::start() {
     if (metrics_) metrics_->start();
     running_ = true;
-    th_ = std::thread(&UdpServer::run_loop, this);
+    std::lock_guard<std::mutex> lg(workers_mu_);
+    // Every inherited socket gets a reader; an unread group member would
+    // silently swallow the flows the kernel hashes to it.
+    const size_t want = std::max<size_t>(std::max(cfg_.workers, 1), 1 + spare_socks_.size());
+    while (workers_.size() < want) spawn_worker();
+    cfg_.workers = static_cast<int>(want);
 }
 
-void UdpServer::stop() {
-    if (th_.joinable()) {
-        running_ = false;
-        th_.join();
+void UdpServer::add_sockets(std::vector<std::unique_ptr<ISocket>> extra) {
+    std::lock_guard<std::mutex> lg(workers_mu_);
+    for (auto& s : extra) spare_socks_.push_back(std::move(s));
+}
+
+std::vector<int> UdpServer::socket_fds() const {
+    std::lock_guard<std::mutex> lg(workers_mu_);
+    std::vector<int> fds{sock_->fd()};
+    for (const auto& w : workers_) {
+        if (w->own_sock) fds.push_back(w->own_sock->fd());
     }
+    return fds;
+}
+
+// Applies buffer sizes and timestamping to an additional worker socket the
+// same way the constructor did for the primary one.
+void UdpServer::configure_socket(ISocket& s) {
+    s.set_rcvbuf(std::max(cfg_.rcvbuf, rcvbuf_bytes_.load() / 2));
+    s.set_sndbuf(cfg_.sndbuf);
+    if (cfg_.timestamps) s.enable_timestamps(true, false);
+}
+
+void UdpServer::stop() {
+    running_ = false;
+    std::lock_guard<std::mutex> lg(workers_mu_);
+    // Workers finish the batch in hand and exit; whatever is still queued in
+    // the kernel socket stays there for a successor sharing the fd.
+    for (auto& w : workers_) retire_worker(*w);
+    workers_.clear();
     if (metrics_) metrics_->stop();
 }
 
-void UdpServer::run_loop() {
-    std::vector<std::vector<uint8_t>> bufs(cfg_.batch, std::vector<uint8_t>(2048));
-    uint64_t last_recv_total = 0;
+// Caller holds workers_mu_.
+void UdpServer::spawn_worker() {
+    auto w = std::make_unique<Worker>();
+    if (workers_.empty()) {
+        w->sock = sock_.get();
+        w->owns_socket = true;
+    } else {
+        if (!spare_socks_.empty()) {
+            w->own_sock = std::move(spare_socks_.back());
+            spare_socks_.pop_back();
+        } else {
+            w->own_sock = sock_->reuseport_sibling();
+        }
+        if (w->own_sock) {
+            configure_socket(*w->own_sock);
+            w->sock = w->own_sock.get();
+            w->owns_socket = true;
+        } else {
+            w->sock = sock_.get();
+            if (cfg_.verbose && !shared_warned_) {
+                std::cerr << "[server] no SO_REUSEPORT group: workers share one socket, so a flow's "
+                             "packets (and flow stats) are split between them\n";
+            }
+            shared_warned_ = true;
+        }
+    }
+    for (int i = 0; i < cfg_.proc_threads; ++i) {
+        auto st = std::make_unique<Stage>(cfg_.ring_size);
+        st->sock = w->sock;
+        st->th = std::thread(&UdpServer::process_loop, this, st.get());
+        w->stages.push_back(std::move(st));
+    }
+    size_t index = workers_.size();
+    w->th = std::thread(&UdpServer::run_loop, this, w.get(), index);
+    workers_.push_back(std::move(w));
+}
+
+// Stops the receive thread first, then lets each processing thread drain its
+// ring before exiting.
+void UdpServer::retire_worker(Worker& w) {
+    w.running = false;
+    if (w.th.joinable()) w.th.join();
+    for (auto& st : w.stages) {
+        st->stop = true;
+        if (st->th.joinable()) st->th.join();
+    }
+}
+
+static std::string join_cpus(const std::vector<int>& cpus) {
+    std::string out;
+    for (int c : cpus) out += (out.empty() ? "" : ",") + std::to_string(c);
+    return out.empty() ? "-" : out;
+}
+
+// Allowed CPUs on `node`; every allowed CPU when the node is unknown or has
+// none we may use (e.g. a cpuset that excludes it).
+std::vector<int> UdpServer::node_cpus(int node) const {
+    std::vector<int> out;
+    for (int c : topo_.cpus_on_node(node)) {
+        if (std::find(allowed_cpus_.begin(), allowed_cpus_.end(), c) != allowed_cpus_.end()) out.push_back(c);
+    }
+    return out.empty() ? allowed_cpus_ : out;
+}
+
+// Pins the calling receive thread to one CPU of `node` and tells its
+// processing threads to follow it onto that node.
+void UdpServer::place_worker(Worker* self, size_t index, int node) {
+    std::vector<int> cands = node_cpus(node);
+    if (cands.empty()) return;
+    const int cpu = cands[index % cands.size()];
+    if (!pin_current_thread({cpu})) return;
+    self->cpu = cpu;
+    self->node = topo_.node_of(cpu);
+    self->pinned = true;
+    for (auto& st : self->stages) st->node = self->node.load();
+}
+
+std::vector<WorkerPlacement> UdpServer::placement() const {
+    std::lock_guard<std::mutex> lg(workers_mu_);
+    std::vector<WorkerPlacement> out;
+    for (const auto& w : workers_) out.push_back({w->cpu.load(), w->node.load(), w->pinned.load()});
+    return out;
+}
+
+void UdpServer::report_irqs() const {
+    std::cout << "[server] NIC " << cfg_.nic << " numa_node=" << home_node_
+              << " local_cpus=" << join_cpus(topo_.cpus_on_node(home_node_)) << "\n";
+    if (irqs_.empty()) {
+        std::cout << "[server]   no IRQs found for " << cfg_.nic << " (virtual device?)\n";
+        return;
+    }
+    for (const auto& irq : irqs_) {
+        bool local = !irq.cpus.empty();
+        for (int c : irq.cpus) local = local && topo_.node_of(c) == home_node_;
+        std::cout << "[server]   irq " << irq.irq << " " << (irq.name.empty() ? "?" : irq.name)
+                  << " -> cpus " << join_cpus(irq.cpus)
+                  << (home_node_ < 0 || local ? "" : "  (not NIC-local)") << "\n";
+    }
+}
+
+size_t UdpServer::worker_count() const {
+    std::lock_guard<std::mutex> lg(workers_mu_);
+    return workers_.size();
+}
+
+bool UdpServer::reconfigure(const ServerConfig& next) {
+    if (next.batch > 0 && next.batch != batch_target_.load()) {
+        batch_target_ = next.batch;
+        reconfig_gen_.fetch_add(1);
+    }
+    std::lock_guard<std::mutex> lg(workers_mu_);
+    size_t want = static_cast<size_t>(std::max(next.workers, 1));
+    if (!running_) { cfg_.workers = static_cast<int>(want); return true; }
+    // A real socket gets every new worker its own group member up front, or
+    // the resize is refused; in-process sockets have no group and are shared.
+    if (sock_->fd() >= 0) {
+        std::vector<std::unique_ptr<ISocket>> opened;
+        while (workers_.size() + spare_socks_.size() + opened.size() < want) {
+            auto s = sock_->reuseport_sibling();
+            if (!s) return false;  // closes the members opened so far, unread
+            opened.push_back(std::move(s));
+        }
+        for (auto& s : opened) spare_socks_.push_back(std::move(s));
+    }
+    // Each worker reads its own socket, so retiring one closes that group
+    // member: run_loop first drains what the kernel already queued on it, and
+    // its flows re-hash to the sockets that remain. Worker 0 (the reporter,
+    // reading the primary socket) is never retired.
+    while (workers_.size() < want) spawn_worker();
+    while (workers_.size() > want) {
+        retire_worker(*workers_.back());
+        workers_.pop_back();
+    }
+    cfg_.workers = static_cast<int>(want);
+    if (cfg_.verbose) {
+        std::cout << "[server] reconfigured: workers=" << want << " batch=" << batch_target_.load() << "\n";
+    }
+    return true;
+}
+
+void UdpServer::handle_batch(ISocket& sock, std::vector<std::vector<uint8_t>>& bufs,
+                             std::vector<PacketMeta>& meta, size_t n, FlowTable& flows) {
+    // Stages measured against kernel stamps are only recorded while the
+    // timestamps feature is on; otherwise rx_ts_ns is not a kernel stamp.
+    const bool stamped = cfg_.timestamps;
+    const uint64_t t_user = stamped ? wall_ns() : 0;
+    const uint64_t now = now_ns();
+    stats_.inc_recv(n);
+    uint64_t rx_bytes = 0;
+    for (size_t i=0;i<n;i++) rx_bytes += meta[i].len;
+    stats_.add_rx_bytes(rx_bytes);
+
+    // Admission control runs first so shed packets never reach the stages below.
+    // Survivors are compacted to the front of the batch in place.
+    size_t kept = n;
+    if (limiter_.enabled()) {
+        std::lock_guard<std::mutex> lg(limiter_mu_);
+        kept = 0;
+        for (size_t i=0;i<n;i++) {
+            auto v = limiter_.admit(addr_hash(make_client_key(meta[i].peer)), now);
+            if (v == RateLimiter::Verdict::ClientLimited) { stats_.inc_dropped(DropReason::ClientRate, 1); continue; }
+            if (v == RateLimiter::Verdict::GlobalLimited) { stats_.inc_dropped(DropReason::GlobalRate, 1); continue; }
+            if (kept != i) {
+                std::swap(bufs[kept], bufs[i]);
+                std::swap(meta[kept], meta[i]);
+            }
+            ++kept;
+        }
+    }
+
+    for (size_t i=0;i<kept;i++) {
+        uint64_t seq = 0;
+        if (meta[i].len >= sizeof(PacketHeader)) {
+            PacketHeader* hdr = reinterpret_cast<PacketHeader*>(bufs[i].data());
+            if (hdr->magic == kMagic) {
+                seq = hdr->seq;
+                // Network delay is only meaningful with clocks synced across hosts;
+                // skew that would make it negative is discarded.
+                uint64_t rx_ts = meta[i].rx_ts_ns;
+                if (stamped && rx_ts && rx_ts > hdr->send_ts_ns)
+                    stats_.record_latency(LatencyStage::Network, rx_ts - hdr->send_ts_ns);
+            }
+        }
+        const ClientKey key = make_client_key(meta[i].peer);
+        const FlowState* f = flows.observe(key, meta[i].len, seq, now);
+        if (!f || f->packets == 1) stats_.note_client(key);  // new (or untracked) flow
+        if (t_user && meta[i].rx_ts_ns && t_user > meta[i].rx_ts_ns)
+            stats_.record_latency(LatencyStage::Queueing, t_user - meta[i].rx_ts_ns);
+    }
+
+    if (cfg_.echo && kept > 0) {
+        std::vector<std::vector<uint8_t>> out;
+        out.reserve(kept);
+        for (size_t i=0;i<kept;i++) out.emplace_back(bufs[i].begin(), bufs[i].begin() + meta[i].len);
+        ssize_t s = sock.send_batch(out, &meta);
+        if (s > 0) {
+            stats_.inc_sent(s);
+            size_t total_bytes = 0; for (ssize_t i=0;i<s;i++) total_bytes += out[i].size();
+            stats_.add_tx_bytes(total_bytes);
+        }
+    }
+    // Every packet handled waits for the whole batch (its echo goes out with
+    // the rest), so each one gets the batch time as its sample.
+    if (t_user && kept > 0) stats_.record_latency(LatencyStage::Processing, wall_ns() - t_user, kept);
+}
+
+void UdpServer::dispatch(Worker* self, std::vector<std::vector<uint8_t>>& bufs,
+                         std::vector<PacketMeta>& meta, size_t n) {
+    // Each source (address and port) sticks to one stage, so a flow's packets stay in
+    // order and its state lives in exactly one stage's flow table.
+    size_t shed = 0;
+    for (size_t i=0;i<n;i++) {
+        Stage& st = *self->stages[ClientKeyHash{}(make_client_key(meta[i].peer)) % self->stages.size()];
+        PacketDesc d{std::move(bufs[i]), meta[i]};
+        if (!st.full.try_push(std::move(d))) {
+            // Never block the receive thread: shed and keep the buffer.
+            bufs[i] = std::move(d.buf);
+            ++shed;
+            continue;
+        }
+        std::vector<uint8_t> b;
+        if (st.free.try_pop(b)) bufs[i] = std::move(b);
+        else bufs[i] = std::vector<uint8_t>(2048);
+    }
+    if (shed) {
+        ring_full_stalls_.fetch_add(shed, std::memory_order_relaxed);
+        stats_.inc_recv(shed);
+        stats_.inc_dropped(DropReason::RingFull, shed);
+    }
+}
+
+void UdpServer::process_loop(Stage* st) {
+    std::vector<std::vector<uint8_t>> bufs;
+    std::vector<PacketMeta> meta;
+    PacketDesc d;
+    int node = -1;
+    FlowTable flows(cfg_.flows, now_ns(), &stats_.flows());
+    for (;;) {
+        const int want = st->node.load(std::memory_order_relaxed);
+        if (want != node) {
+            node = want;
+            pin_current_thread(node_cpus(node));
+        }
+        flows.expire(now_ns());
+        const size_t cap = static_cast<size_t>(std::max(batch_target_.load(std::memory_order_relaxed), 1));
+        size_t n = 0;
+        while (n < cap && st->full.try_pop(d)) {
+            if (bufs.size() <= n) { bufs.emplace_back(); meta.emplace_back(); }
+            bufs[n] = std::move(d.buf);
+            meta[n] = d.meta;
+            ++n;
+        }
+        if (n == 0) {
+            if (st->stop) break;
+            ring_empty_polls_.fetch_add(1, std::memory_order_relaxed);
+            std::this_thread::yield();
+            continue;
+        }
+        handle_batch(*st->sock, bufs, meta, n, flows);
+        // Buffers that do not fit back into the free ring are simply released.
+        for (size_t i=0;i<n;i++) st->free.try_push(std::move(bufs[i]));
+    }
+    // A retired stage's flows are gone; on shutdown the gauge keeps its last value.
+    if (running_) flows.clear();
+}
+
+void UdpServer::render_staging(std::ostream& os) const {
+    os << "# HELP udp_ring_occupancy Descriptors queued between receive and processing threads\n";
+    os << "# TYPE udp_ring_occupancy gauge\n";
+    size_t capacity = 0;
+    {
+        std::lock_guard<std::mutex> lg(workers_mu_);
+        for (size_t w = 0; w < workers_.size(); ++w) {
+            for (size_t s = 0; s < workers_[w]->stages.size(); ++s) {
+                const auto& st = *workers_[w]->stages[s];
+                capacity = st.full.capacity();
+                os << "udp_ring_occupancy{worker=\"" << w << "\",stage=\"" << s << "\"} "
+                   << st.full.size() << "\n";
+            }
+        }
+    }
+    os << "# HELP udp_ring_capacity Descriptor capacity of each ring\n";
+    os << "# TYPE udp_ring_capacity gauge\n";
+    os << "udp_ring_capacity " << capacity << "\n";
+    os << "# HELP udp_ring_stalls_total Ring full (producer) and ring empty (consumer) events\n";
+    os << "# TYPE udp_ring_stalls_total counter\n";
+    os << "udp_ring_stalls_total{side=\"producer\"} " << ring_full_stalls_.load() << "\n";
+    os << "udp_ring_stalls_total{side=\"consumer\"} " << ring_empty_polls_.load() << "\n";
+}
+
+void UdpServer::render_placement(std::ostream& os) const {
+    os << "# HELP udp_worker_placement Receive thread CPU and NUMA node (1 = pinned, 0 = observed at start)\n";
+    os << "# TYPE udp_worker_placement gauge\n";
+    auto places = placement();
+    for (size_t w = 0; w < places.size(); ++w) {
+        os << "udp_worker_placement{worker=\"" << w << "\",cpu=\"" << places[w].cpu
+           << "\",node=\"" << places[w].node << "\"} " << (places[w].pinned ? 1 : 0) << "\n";
+    }
+    os << "# HELP udp_numa_nodes NUMA nodes discovered at startup\n";
+    os << "# TYPE udp_numa_nodes gauge\n";
+    os << "udp_numa_nodes " << topo_.node_count() << "\n";
+    if (irqs_.empty()) return;
+    const int node = home_node_ >= 0 ? home_node_ : (places.empty() ? -1 : places[0].node);
+    os << "# HELP udp_nic_irq_node_local NIC IRQ affinity entirely on the receive node (1) or not (0)\n";
+    os << "# TYPE udp_nic_irq_node_local gauge\n";
+    for (const auto& irq : irqs_) {
+        bool local = !irq.cpus.empty();
+        for (int c : irq.cpus) local = local && topo_.node_of(c) == node;
+        os << "udp_nic_irq_node_local{irq=\"" << irq.irq << "\",name=\"" << irq.name << "\"} "
+           << (local ? 1 : 0) << "\n";
+    }
+}
+
+void UdpServer::apply_tuning(ISocket& sock, const BatchTuner& tuner, const BatchTuner::Decision& d) {
+    fill_permille_ = static_cast<uint32_t>(tuner.last_fill_ratio() * 1000.0);
+    if (d.grew) ++tune_grow_;
+    if (d.shrank) ++tune_shrink_;
+    if (d.raise_rcvbuf) {
+        int cur = sock.rcvbuf();
+        // The kernel reports double the requested value; request from the halved size.
+        int want = tuner.next_rcvbuf(cur / 2);
+        if (want > cur / 2) {
+            sock.set_rcvbuf(want);
+            int eff = sock.rcvbuf();
+            if (eff > cur) ++rcvbuf_raises_;
+            rcvbuf_bytes_ = eff;
+            if (cfg_.verbose) std::cout << "[server] autotune: rcvbuf " << cur << " -> " << eff << " bytes\n";
+        }
+    }
+    if ((d.grew || d.shrank) && cfg_.verbose) {
+        std::cout << "[server] autotune: batch " << batch_now_.load() << " -> " << d.batch
+                  << " (fill=" << tuner.last_fill_ratio() << ")\n";
+    }
+    batch_now_ = d.batch;
+}
+
+void UdpServer::render_tuning(std::ostream& os) const {
+    os << "# HELP udp_batch_size Current recvmmsg batch size\n";
+    os << "# TYPE udp_batch_size gauge\n";
+    os << "udp_batch_size " << batch_now_.load() << "\n";
+    os << "# HELP udp_batch_fill_ratio Average batch fill ratio over the last autotune window\n";
+    os << "# TYPE udp_batch_fill_ratio gauge\n";
+    os << "udp_batch_fill_ratio " << fill_permille_.load() / 1000.0 << "\n";
+    os << "# HELP udp_socket_rcvbuf_bytes Effective SO_RCVBUF as reported by the kernel\n";
+    os << "# TYPE udp_socket_rcvbuf_bytes gauge\n";
+    os << "udp_socket_rcvbuf_bytes " << rcvbuf_bytes_.load() << "\n";
+    os << "# HELP udp_autotune_decisions_total Autotune actions taken\n";
+    os << "# TYPE udp_autotune_decisions_total counter\n";
+    os << "udp_autotune_decisions_total{action=\"batch_grow\"} " << tune_grow_.load() << "\n";
+    os << "udp_autotune_decisions_total{action=\"batch_shrink\"} " << tune_shrink_.load() << "\n";
+    os << "udp_autotune_decisions_total{action=\"rcvbuf_raise\"} " << rcvbuf_raises_.load() << "\n";
+}
+
+void UdpServer::run_loop(Worker* self, size_t index) {
+    // Place the thread before allocating its buffers so they are first touched,
+    // and therefore backed by memory, on the thread's own NUMA node.
+    bool placed = true;
+    if (cfg_.pin_workers) {
+        place_worker(self, index, home_node_);
+        // Without a NIC hint, learn the RX queue's node from the first packet.
+        placed = home_node_ >= 0;
+    } else {
+        self->cpu = sched_getcpu();
+        self->node = topo_.node_of(self->cpu);
+    }
+    // Inline mode owns a flow table; staged mode keeps them on the processing threads.
+    std::unique_ptr<FlowTable> flows;
+    if (self->stages.empty()) flows = std::make_unique<FlowTable>(cfg_.flows, now_ns(), &stats_.flows());
+    uint32_t gen = reconfig_gen_.load();
+    BatchTuner tuner(cfg_.autotune, batch_target_.load());
+    const int initial = cfg_.autotune.enabled ? tuner.batch() : batch_target_.load();
+    batch_now_ = initial;
+    std::vector<std::vector<uint8_t>> bufs(initial, std::vector<uint8_t>(2048));
+    std::vector<PacketMeta> meta(initial);
+    ISocket& sock = *self->sock;
+    uint64_t last_recv_total = stats_.recv();
+    uint64_t last_kernel_drops = 0;
     auto last_ts = std::chrono::steady_clock::now();
-    while (running_) {
-        ssize_t r = sock_->recv_batch(bufs);
-        if (r < 0) continue;
+    while (running_ && self->running) {
+        if (reconfig_gen_.load(std::memory_order_relaxed) != gen) {
+            // Batch size changed by reload: restart the tuner from the new size.
+            gen = reconfig_gen_.load();
+            tuner = BatchTuner(cfg_.autotune, batch_target_.load());
+            int b = cfg_.autotune.enabled ? tuner.batch() : batch_target_.load();
+            bufs.resize(b, std::vector<uint8_t>(2048));
+            meta.resize(b);
+            batch_now_ = b;
+        }
+        ssize_t r = sock.recv_batch(bufs, &meta);
         if (r > 0) {
-            for (ssize_t i=0;i<r;i++) {
-                // Track client from a fake header: in real world we would read src addr from recvmmsg
-                // Here we approximate by requiring clients to include magic header at start
-                if (bufs[i].size() >= sizeof(PacketHeader)) {
-                    PacketHeader* hdr = reinterpret_cast<PacketHeader*>(bufs[i].data());
-                    if (hdr->magic == kMagic) {
-                        // Cannot access peer addr without msghdr name here (already set in socket), so skip addr track
-                    }
+            uint64_t t0 = cfg_.autotune.enabled ? now_ns() : 0;
+            if (flows) handle_batch(sock, bufs, meta, static_cast<size_t>(r), *flows);
+            else dispatch(self, bufs, meta, static_cast<size_t>(r));
+            if (t0) tuner.on_batch(static_cast<size_t>(r), now_ns() - t0);
+            if (!placed) {
+                placed = true;
+                const int node = topo_.node_of(sock.incoming_cpu());
+                if (node >= 0 && node != self->node.load()) {
+                    place_worker(self, index, node);
+                    for (auto& b : bufs) b = std::vector<uint8_t>(2048);
+                    meta.assign(meta.size(), PacketMeta{});
                 }
-                stats_.inc_recv(1);
-                stats_.add_rx_bytes(bufs[i].size());
             }
-            if (cfg_.echo) {
-                // Echo back
-                std::vector<std::vector<uint8_t>> out;
-                out.reserve(r);
-                for (ssize_t i=0;i<r;i++) out.push_back(bufs[i]);
-                ssize_t s = sock_->send_batch(out, nullptr);
-                if (s > 0) {
-                    stats_.inc_sent(s);
-                    size_t total_bytes = 0; for (auto& b: out) total_bytes += b.size();
-                    stats_.add_tx_bytes(total_bytes);
+        }
+        // Expiry is driven from here: a no-op until the wheel's next tick.
+        if (flows) flows->expire(now_ns());
+        if (cfg_.autotune.enabled) {
+            auto d = tuner.tick(now_ns(), sock.rx_dropped());
+            if (d.evaluated) {
+                apply_tuning(sock, tuner, d);
+                // Resizing only happens on a decision (at most once per interval),
+                // so the reallocation cost stays off the per-batch path.
+                if (d.grew || d.shrank) {
+                    bufs.resize(d.batch, std::vector<uint8_t>(2048));
+                    meta.resize(d.batch);
                 }
             }
         }
         auto now = std::chrono::steady_clock::now();
         if (now - last_ts >= std::chrono::seconds(1)) {
+            last_ts = now;
+            // Each socket's overflow counter is read by the one worker that owns it.
+            uint64_t kernel_drops = self->owns_socket ? sock.rx_dropped() : 0;
+            if (kernel_drops > last_kernel_drops) {
+                stats_.inc_dropped(DropReason::SocketOverflow, kernel_drops - last_kernel_drops);
+                last_kernel_drops = kernel_drops;
+            }
+            if (index != 0) continue;
             uint64_t recv_total = stats_.recv();
             uint64_t delta = recv_total - last_recv_total;
             last_rate_pps_ = static_cast<double>(delta);
@@ -77,9 +525,18 @@ void UdpServer::run_loop() {
                           << " rate=" << human_rate(last_rate_pps_) << "\n";
             }
             last_recv_total = recv_total;
-            last_ts = now;
         }
     }
+    if (running_ && self->own_sock) {
+        // Retired while the server keeps running: this socket closes with the
+        // worker, so serve what the kernel already queued on it first.
+        ssize_t r;
+        while ((r = sock.recv_batch(bufs, &meta)) > 0) {
+            if (flows) handle_batch(sock, bufs, meta, static_cast<size_t>(r), *flows);
+            else dispatch(self, bufs, meta, static_cast<size_t>(r));
+        }
+    }
+    if (flows && running_) flows->clear();
 }
 
 } // namespace udp
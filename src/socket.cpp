@@ -6,9 +6,25 @@
 #include <cerrno>
 #include <sys/types.h>
 #include <fcntl.h>
+#include <poll.h>
+#include <thread>
+#if defined(__linux__)
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
+#endif
 
 namespace udp {
 
+// Per-message control buffer for recvmmsg: room for scm_timestamping plus a
+// few small cmsgs.
+static constexpr size_t kCtrlLen = 128;
+
+bool ISocket::wait_readable(int timeout_ms) {
+    (void)timeout_ms;
+    std::this_thread::yield();
+    return true;
+}
+
 void ISocket::set_rcvbuf(int bytes) {
     (void)bytes;
 }
@@ -17,17 +33,91 @@ void ISocket::set_sndbuf(int bytes) {
     (void)bytes;
 }
 
-static int make_socket() {
-    int s = ::socket(AF_INET, SOCK_DGRAM, 0);
-    if (s < 0) throw std::runtime_error("socket() failed");
+bool ISocket::enable_timestamps(bool rx, bool tx) {
+    (void)rx; (void)tx;
+    return false;
+}
+
+size_t ISocket::read_tx_timestamps(std::vector<TxTimestamp>& out) {
+    (void)out;
+    return 0;
+}
+
+#if defined(__linux__)
+static uint64_t timespec_ns(const timespec& ts) {
+    return static_cast<uint64_t>(ts.tv_sec) * 1'000'000'000ull + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+// Walks a received message's cmsgs. Returns the kernel software timestamp
+// (CLOCK_REALTIME, 0 if none present), and stores the SO_RXQ_OVFL drop
+// counter in `drops` when the kernel attached it. Raw hardware stamps are in
+// the NIC's PHC clock domain and cannot be compared with the sender's
+// CLOCK_REALTIME header stamp, so they are not used.
+static uint64_t parse_rx_cmsgs(msghdr& mh, uint32_t& drops) {
+    uint64_t ts = 0;
+    for (cmsghdr* c = CMSG_FIRSTHDR(&mh); c; c = CMSG_NXTHDR(&mh, c)) {
+        if (c->cmsg_level != SOL_SOCKET) continue;
+        if (c->cmsg_type == SO_RXQ_OVFL) {
+            memcpy(&drops, CMSG_DATA(c), sizeof(drops));
+        } else if (c->cmsg_type == SCM_TIMESTAMPING) {
+            timespec stamps[3];
+            memcpy(stamps, CMSG_DATA(c), sizeof(stamps));
+            ts = timespec_ns(stamps[0]);
+        } else if (c->cmsg_type == SCM_TIMESTAMPNS) {
+            timespec t;
+            memcpy(&t, CMSG_DATA(c), sizeof(t));
+            ts = timespec_ns(t);
+        }
+    }
+    return ts;
+}
+#endif
+
+static int make_socket(AddressFamily family) {
+    int domain = family == AddressFamily::V4 ? AF_INET : AF_INET6;
+    int s = ::socket(domain, SOCK_DGRAM, 0);
+    if (s < 0) throw std::runtime_error("socket() failed: " + std::string(strerror(errno)));
+    if (domain == AF_INET6) {
+        int v6only = family == AddressFamily::V6 ? 1 : 0;
+        setsockopt(s, IPPROTO_IPV6, IPV6_V6ONLY, &v6only, sizeof(v6only));
+    }
     int flags = fcntl(s, F_GETFL, 0);
     fcntl(s, F_SETFL, flags | O_NONBLOCK);
     return s;
 }
 
-UdpSocket::UdpSocket(int batch_hint) : sockfd_(make_socket()), batch_hint_(batch_hint), connected_(false) {
+UdpSocket::UdpSocket(int batch_hint, AddressFamily family)
+: sockfd_(make_socket(family)), batch_hint_(batch_hint),
+  domain_(family == AddressFamily::V4 ? AF_INET : AF_INET6), connected_(false) {
     int one = 1;
     setsockopt(sockfd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+#if defined(__linux__)
+    // Kernel attaches the cumulative overflow drop count to received datagrams.
+    setsockopt(sockfd_, SOL_SOCKET, SO_RXQ_OVFL, &one, sizeof(one));
+#endif
+}
+
+UdpSocket::UdpSocket(int fd, int batch_hint, int domain)
+: sockfd_(fd), batch_hint_(batch_hint), domain_(domain), connected_(false) {
+    SockAddr local;
+    socklen_t len = sizeof(sockaddr_in6);
+    if (getsockname(sockfd_, &local.sa, &len) == 0) {
+        local.len = len;
+        bound_ = local.port() != 0;
+    }
+}
+
+std::unique_ptr<UdpSocket> UdpSocket::adopt(int fd, int batch_hint) {
+    int type = 0, domain = 0;
+    socklen_t len = sizeof(type);
+    if (getsockopt(fd, SOL_SOCKET, SO_TYPE, &type, &len) < 0 || type != SOCK_DGRAM)
+        throw std::runtime_error("adopt(): fd is not a datagram socket");
+    len = sizeof(domain);
+    if (getsockopt(fd, SOL_SOCKET, SO_DOMAIN, &domain, &len) < 0)
+        throw std::runtime_error("adopt(): cannot query socket domain");
+    int flags = fcntl(fd, F_GETFL, 0);
+    fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+    return std::unique_ptr<UdpSocket>(new UdpSocket(fd, batch_hint, domain));
 }
 
 UdpSocket::~UdpSocket() {
@@ -41,32 +131,42 @@ void UdpSocket::bind(uint16_t port, bool reuseport) {
         setsockopt(sockfd_, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one));
 #endif
     }
-    sockaddr_in addr{};
-    addr.sin_family = AF_INET;
-    addr.sin_addr.s_addr = INADDR_ANY;
-    addr.sin_port = htons(port);
-    if (::bind(sockfd_, (sockaddr*)&addr, sizeof(addr)) < 0)
+    SockAddr addr;
+    if (domain_ == AF_INET6) {
+        addr.v6.sin6_family = AF_INET6;
+        addr.v6.sin6_addr = in6addr_any;
+        addr.v6.sin6_port = htons(port);
+        addr.len = sizeof(sockaddr_in6);
+    } else {
+        addr.v4.sin_family = AF_INET;
+        addr.v4.sin_addr.s_addr = INADDR_ANY;
+        addr.v4.sin_port = htons(port);
+        addr.len = sizeof(sockaddr_in);
+    }
+    if (::bind(sockfd_, &addr.sa, addr.len) < 0)
         throw std::runtime_error("bind() failed: " + std::string(strerror(errno)));
+    bound_ = true;
 }
 
 void UdpSocket::connect(const std::string& ip, uint16_t port) {
-    memset(&peer_, 0, sizeof(peer_));
-    peer_.sin_family = AF_INET;
-    inet_pton(AF_INET, ip.c_str(), &peer_.sin_addr);
-    peer_.sin_port = htons(port);
-    if (::connect(sockfd_, (sockaddr*)&peer_, sizeof(peer_)) < 0)
+    if (!parse_address(ip, port, peer_))
+        throw std::runtime_error("connect() failed: invalid address " + ip);
+    if (domain_ == AF_INET6) peer_ = to_v4_mapped(peer_);
+    else if (peer_.family() != AF_INET)
+        throw std::runtime_error("connect() failed: IPv6 address on an IPv4 socket");
+    if (::connect(sockfd_, &peer_.sa, peer_.len) < 0)
         throw std::runtime_error("connect() failed: " + std::string(strerror(errno)));
     connected_ = true;
 }
 
-ssize_t UdpSocket::recv_batch(std::vector<std::vector<uint8_t>>& bufs) {
+ssize_t UdpSocket::recv_batch(std::vector<std::vector<uint8_t>>& bufs, std::vector<PacketMeta>* meta) {
 #if defined(__linux__)
     // Use recvmmsg if available
     const size_t n = bufs.size();
     std::vector<iovec> iov(n);
     std::vector<mmsghdr> msgs(n);
-    std::vector<sockaddr_in> addrs(n);
-    std::vector<char> ctrl(64 * n);
+    std::vector<SockAddr> addrs(n);
+    std::vector<char> ctrl(kCtrlLen * n);
 
     for (size_t i=0;i<n;i++) {
         iov[i].iov_base = bufs[i].data();
@@ -74,27 +174,49 @@ ssize_t UdpSocket::recv_batch(std::vector<std::vector<uint8_t>>& bufs) {
         memset(&msgs[i], 0, sizeof(mmsghdr));
         msgs[i].msg_hdr.msg_iov = &iov[i];
         msgs[i].msg_hdr.msg_iovlen = 1;
-        msgs[i].msg_hdr.msg_name = &addrs[i];
-        msgs[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
-        msgs[i].msg_hdr.msg_control = ctrl.data() + i*64;
-        msgs[i].msg_hdr.msg_controllen = 64;
+        msgs[i].msg_hdr.msg_name = &addrs[i].sa;
+        msgs[i].msg_hdr.msg_namelen = sizeof(sockaddr_in6);
+        msgs[i].msg_hdr.msg_control = ctrl.data() + i*kCtrlLen;
+        msgs[i].msg_hdr.msg_controllen = kCtrlLen;
     }
     int r = recvmmsg(sockfd_, msgs.data(), n, 0, nullptr);
     if (r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return 0;
     if (r < 0) return -1;
+    if (meta && meta->size() < n) meta->resize(n);
+    uint32_t drops = 0;
+    for (int i=0;i<r;i++) {
+        uint64_t ts = msgs[i].msg_hdr.msg_controllen ? parse_rx_cmsgs(msgs[i].msg_hdr, drops) : 0;
+        if (meta) {
+            addrs[i].len = msgs[i].msg_hdr.msg_namelen;
+            (*meta)[i].peer = addrs[i];
+            (*meta)[i].len = msgs[i].msg_len;
+            (*meta)[i].rx_ts_ns = rx_timestamps_ ? ts : 0;
+        }
+    }
+    // The counter is per socket and monotonic (mod 2^32); keep the largest seen
+    // since several threads may receive on the same socket.
+    uint64_t prev = rx_dropped_.load(std::memory_order_relaxed);
+    while (drops > prev && !rx_dropped_.compare_exchange_weak(prev, drops, std::memory_order_relaxed)) {}
     return r;
 #else
     // Fallback to single recvfrom
-    sockaddr_in addr{};
-    socklen_t alen = sizeof(addr);
-    ssize_t r = recvfrom(sockfd_, bufs[0].data(), bufs[0].size(), 0, (sockaddr*)&addr, &alen);
+    SockAddr addr;
+    socklen_t alen = sizeof(sockaddr_in6);
+    ssize_t r = recvfrom(sockfd_, bufs[0].data(), bufs[0].size(), 0, &addr.sa, &alen);
     if (r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return 0;
     if (r < 0) return -1;
+    if (meta) {
+        if (meta->empty()) meta->resize(1);
+        addr.len = alen;
+        (*meta)[0].peer = addr;
+        (*meta)[0].len = static_cast<uint32_t>(r);
+        (*meta)[0].rx_ts_ns = 0;
+    }
     return 1;
 #endif
 }
 
-ssize_t UdpSocket::send_batch(const std::vector<std::vector<uint8_t>>& bufs, const sockaddr_in* addr) {
+ssize_t UdpSocket::send_batch(const std::vector<std::vector<uint8_t>>& bufs, const std::vector<PacketMeta>* meta) {
 #if defined(__linux__)
     const size_t n = bufs.size();
     std::vector<iovec> iov(n);
@@ -105,9 +227,10 @@ ssize_t UdpSocket::send_batch(const std::vector<std::vector<uint8_t>>& bufs, con
         memset(&msgs[i], 0, sizeof(mmsghdr));
         msgs[i].msg_hdr.msg_iov = &iov[i];
         msgs[i].msg_hdr.msg_iovlen = 1;
-        if (!connected_) {
-            msgs[i].msg_hdr.msg_name = const_cast<sockaddr_in*>(addr);
-            msgs[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+        if (!connected_ && meta) {
+            const SockAddr& a = (*meta)[i].peer;
+            msgs[i].msg_hdr.msg_name = const_cast<sockaddr*>(&a.sa);
+            msgs[i].msg_hdr.msg_namelen = a.len;
         }
     }
     int r = sendmmsg(sockfd_, msgs.data(), n, 0);
@@ -117,36 +240,178 @@ ssize_t UdpSocket::send_batch(const std::vector<std::vector<uint8_t>>& bufs, con
 #else
     // Fallback to single sendto/connect
     ssize_t cnt = 0;
-    for (auto& b : bufs) {
+    for (size_t i=0;i<bufs.size();i++) {
+        auto& b = bufs[i];
         ssize_t r;
-        if (connected_) r = ::send(sockfd_, b.data(), b.size(), 0);
-        else r = ::sendto(sockfd_, b.data(), b.size(), 0, (sockaddr*)addr, sizeof(sockaddr_in));
+        if (connected_ || !meta) r = ::send(sockfd_, b.data(), b.size(), 0);
+        else r = ::sendto(sockfd_, b.data(), b.size(), 0, &(*meta)[i].peer.sa, (*meta)[i].peer.len);
         if (r >= 0) cnt++;
     }
     return cnt;
 #endif
 }
 
+bool UdpSocket::enable_timestamps(bool rx, bool tx) {
+#if defined(__linux__)
+    int flags = 0;
+    if (rx) flags |= SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+    if (tx) {
+        flags |= SOF_TIMESTAMPING_TX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE | SOF_TIMESTAMPING_OPT_ID;
+#ifdef SOF_TIMESTAMPING_OPT_TSONLY
+        flags |= SOF_TIMESTAMPING_OPT_TSONLY;
+#endif
+    }
+    bool ok = setsockopt(sockfd_, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags)) == 0;
+    if (!ok && rx && !tx) {
+        // Older kernels: nanosecond software RX stamps only.
+        int one = 1;
+        ok = setsockopt(sockfd_, SOL_SOCKET, SO_TIMESTAMPNS, &one, sizeof(one)) == 0;
+    }
+    rx_timestamps_ = ok && rx;
+    tx_timestamps_ = ok && tx;
+    return ok;
+#else
+    (void)rx; (void)tx;
+    return false;
+#endif
+}
+
+size_t UdpSocket::read_tx_timestamps(std::vector<TxTimestamp>& out) {
+    size_t got = 0;
+#if defined(__linux__)
+    if (!tx_timestamps_) return 0;
+    for (;;) {
+        char ctrl[kCtrlLen];
+        char data[64];
+        iovec iov{data, sizeof(data)};
+        msghdr mh{};
+        mh.msg_iov = &iov;
+        mh.msg_iovlen = 1;
+        mh.msg_control = ctrl;
+        mh.msg_controllen = sizeof(ctrl);
+        if (recvmsg(sockfd_, &mh, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) break;
+        uint64_t ts = 0;
+        bool have_id = false;
+        uint32_t id = 0;
+        for (cmsghdr* c = CMSG_FIRSTHDR(&mh); c; c = CMSG_NXTHDR(&mh, c)) {
+            if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_TIMESTAMPING) {
+                timespec stamps[3];
+                memcpy(stamps, CMSG_DATA(c), sizeof(stamps));
+                ts = timespec_ns(stamps[0]);
+            } else if ((c->cmsg_level == SOL_IP && c->cmsg_type == IP_RECVERR) ||
+                       (c->cmsg_level == SOL_IPV6 && c->cmsg_type == IPV6_RECVERR)) {
+                sock_extended_err err;
+                memcpy(&err, CMSG_DATA(c), sizeof(err));
+                if (err.ee_origin == SO_EE_ORIGIN_TIMESTAMPING) {
+                    id = err.ee_data;
+                    have_id = true;
+                }
+            }
+        }
+        if (ts && have_id) {
+            out.push_back(TxTimestamp{id, ts});
+            ++got;
+        }
+    }
+#else
+    (void)out;
+#endif
+    return got;
+}
+
+// SO_*BUFFORCE bypasses net.core.[rw]mem_max but needs CAP_NET_ADMIN; fall back
+// to the capped option otherwise. Callers read the effective size back.
 void UdpSocket::set_rcvbuf(int bytes) {
+#ifdef SO_RCVBUFFORCE
+    if (setsockopt(sockfd_, SOL_SOCKET, SO_RCVBUFFORCE, &bytes, sizeof(bytes)) == 0) return;
+#endif
     setsockopt(sockfd_, SOL_SOCKET, SO_RCVBUF, &bytes, sizeof(bytes));
 }
 void UdpSocket::set_sndbuf(int bytes) {
+#ifdef SO_SNDBUFFORCE
+    if (setsockopt(sockfd_, SOL_SOCKET, SO_SNDBUFFORCE, &bytes, sizeof(bytes)) == 0) return;
+#endif
     setsockopt(sockfd_, SOL_SOCKET, SO_SNDBUF, &bytes, sizeof(bytes));
 }
 
-ssize_t MockSocket::recv_batch(std::vector<std::vector<uint8_t>>& bufs) {
+int UdpSocket::rcvbuf() const {
+    int v = 0;
+    socklen_t len = sizeof(v);
+    getsockopt(sockfd_, SOL_SOCKET, SO_RCVBUF, &v, &len);
+    return v;
+}
+
+bool UdpSocket::wait_readable(int timeout_ms) {
+    pollfd p{sockfd_, POLLIN, 0};
+    return ::poll(&p, 1, timeout_ms) > 0;
+}
+
+std::unique_ptr<ISocket> UdpSocket::reuseport_sibling() {
+#ifdef SO_REUSEPORT
+    int on = 0;
+    socklen_t len = sizeof(on);
+    if (getsockopt(sockfd_, SOL_SOCKET, SO_REUSEPORT, &on, &len) < 0 || !on) return nullptr;
+    SockAddr local;
+    len = sizeof(sockaddr_in6);
+    if (getsockname(sockfd_, &local.sa, &len) < 0) return nullptr;
+    local.len = len;
+    AddressFamily family = AddressFamily::V4;
+    if (domain_ == AF_INET6) {
+        int v6only = 0;
+        len = sizeof(v6only);
+        getsockopt(sockfd_, IPPROTO_IPV6, IPV6_V6ONLY, &v6only, &len);
+        family = v6only ? AddressFamily::V6 : AddressFamily::Dual;
+    }
+    auto s = std::make_unique<UdpSocket>(batch_hint_, family);
+    setsockopt(s->sockfd_, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on));
+    if (::bind(s->sockfd_, &local.sa, local.len) < 0) return nullptr;
+    s->bound_ = true;
+    return s;
+#else
+    return nullptr;
+#endif
+}
+
+int UdpSocket::incoming_cpu() const {
+#ifdef SO_INCOMING_CPU
+    int cpu = -1;
+    socklen_t len = sizeof(cpu);
+    if (getsockopt(sockfd_, SOL_SOCKET, SO_INCOMING_CPU, &cpu, &len) == 0) return cpu;
+#endif
+    return -1;
+}
+
+int UdpSocket::sndbuf() const {
+    int v = 0;
+    socklen_t len = sizeof(v);
+    getsockopt(sockfd_, SOL_SOCKET, SO_SNDBUF, &v, &len);
+    return v;
+}
+
+ssize_t MockSocket::recv_batch(std::vector<std::vector<uint8_t>>& bufs, std::vector<PacketMeta>* meta) {
+    std::lock_guard<std::mutex> lg(mu_);
+    if (meta && meta->size() < bufs.size()) meta->resize(bufs.size());
     size_t i=0;
     for (; i<bufs.size() && recv_cursor_ < rx_store_.size(); ++i, ++recv_cursor_) {
         auto& src = rx_store_[recv_cursor_];
         auto& dst = bufs[i];
         size_t n = std::min(dst.size(), src.size());
         std::copy(src.begin(), src.begin()+n, dst.begin());
+        if (meta) {
+            (*meta)[i].peer = rx_peers_[recv_cursor_];
+            (*meta)[i].len = static_cast<uint32_t>(n);
+            (*meta)[i].rx_ts_ns = rx_ts_[recv_cursor_];
+        }
     }
     return static_cast<ssize_t>(i);
 }
 
-ssize_t MockSocket::send_batch(const std::vector<std::vector<uint8_t>>& bufs, const sockaddr_in* ) {
-    for (auto& b : bufs) tx_store_.push_back(b);
+ssize_t MockSocket::send_batch(const std::vector<std::vector<uint8_t>>& bufs, const std::vector<PacketMeta>* meta) {
+    std::lock_guard<std::mutex> lg(mu_);
+    for (size_t i=0;i<bufs.size();i++) {
+        tx_store_.push_back(bufs[i]);
+        tx_peers_.push_back(meta ? (*meta)[i].peer : SockAddr{});
+    }
     return static_cast<ssize_t>(bufs.size());
 }
 
@@ -0,0 +1,162 @@
+
+#include "udp/topology.hpp"
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+namespace udp {
+
+static bool read_line(const std::string& path, std::string& out) {
+    std::ifstream in(path);
+    if (!in) return false;
+    std::getline(in, out);
+    return true;
+}
+
+static int read_int(const std::string& path, int fallback) {
+    std::string s;
+    if (!read_line(path, s) || s.empty()) return fallback;
+    return std::atoi(s.c_str());
+}
+
+// Numeric suffixes of entries named `<prefix><n>` in `dir`, sorted.
+static std::vector<int> numbered_entries(const std::string& dir, const std::string& prefix) {
+    std::vector<int> out;
+    DIR* d = ::opendir(dir.c_str());
+    if (!d) return out;
+    while (dirent* e = ::readdir(d)) {
+        std::string name = e->d_name;
+        if (name.size() <= prefix.size() || name.compare(0, prefix.size(), prefix) != 0) continue;
+        std::string num = name.substr(prefix.size());
+        if (num.find_first_not_of("0123456789") != std::string::npos) continue;
+        out.push_back(std::atoi(num.c_str()));
+    }
+    ::closedir(d);
+    std::sort(out.begin(), out.end());
+    return out;
+}
+
+std::vector<int> Topology::parse_cpulist(const std::string& s) {
+    std::vector<int> out;
+    std::stringstream ss(s);
+    std::string part;
+    while (std::getline(ss, part, ',')) {
+        if (part.empty() || !std::isdigit(static_cast<unsigned char>(part[0]))) continue;
+        auto dash = part.find('-');
+        int lo = std::atoi(part.c_str());
+        int hi = dash == std::string::npos ? lo : std::atoi(part.c_str() + dash + 1);
+        for (int c = lo; c <= hi; ++c) out.push_back(c);
+    }
+    return out;
+}
+
+Topology Topology::discover(const std::string& sys_root) {
+    Topology t;
+    const std::string cpu_dir = sys_root + "/devices/system/cpu";
+    std::string online;
+    std::vector<int> ids = read_line(cpu_dir + "/online", online) ? parse_cpulist(online)
+                                                                 : numbered_entries(cpu_dir, "cpu");
+    for (int c : ids) {
+        CpuInfo ci;
+        ci.cpu = c;
+        const std::string topo = cpu_dir + "/cpu" + std::to_string(c) + "/topology/";
+        ci.core = read_int(topo + "core_id", -1);
+        ci.package = read_int(topo + "physical_package_id", -1);
+        t.cpus_.push_back(ci);
+    }
+
+    const std::string node_dir = sys_root + "/devices/system/node";
+    std::vector<int> nodes = numbered_entries(node_dir, "node");
+    for (int n : nodes) {
+        std::string list;
+        if (!read_line(node_dir + "/node" + std::to_string(n) + "/cpulist", list)) continue;
+        for (int c : parse_cpulist(list)) {
+            for (auto& ci : t.cpus_) if (ci.cpu == c) ci.node = n;
+        }
+    }
+    t.nodes_ = nodes.empty() ? 1 : nodes.back() + 1;
+    return t;
+}
+
+int Topology::node_of(int cpu) const {
+    for (const auto& ci : cpus_) if (ci.cpu == cpu) return ci.node;
+    return -1;
+}
+
+std::vector<int> Topology::cpus_on_node(int node) const {
+    std::vector<int> out;
+    for (const auto& ci : cpus_) if (ci.node == node) out.push_back(ci.cpu);
+    return out;
+}
+
+std::vector<int> allowed_cpus() {
+    std::vector<int> out;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) != 0) return out;
+    for (int c = 0; c < CPU_SETSIZE; ++c) if (CPU_ISSET(c, &set)) out.push_back(c);
+    return out;
+}
+
+bool pin_current_thread(const std::vector<int>& cpus) {
+    if (cpus.empty()) return false;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int c : cpus) if (c >= 0 && c < CPU_SETSIZE) CPU_SET(c, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+int nic_numa_node(const std::string& nic, const std::string& sys_root) {
+    return read_int(sys_root + "/class/net/" + nic + "/device/numa_node", -1);
+}
+
+// An IRQ action is the interface name alone or followed by '-' ("eth1-TxRx-0"),
+// so "eth1" does not claim "eth10"'s vectors.
+static bool irq_belongs_to(const std::string& action, const std::string& nic) {
+    if (action.compare(0, nic.size(), nic) != 0) return false;
+    return action.size() == nic.size() || action[nic.size()] == '-';
+}
+
+std::vector<IrqAffinity> nic_irqs(const std::string& nic, const std::string& sys_root,
+                                  const std::string& proc_root) {
+    std::vector<IrqAffinity> out;
+    for (int irq : numbered_entries(sys_root + "/class/net/" + nic + "/device/msi_irqs", "")) {
+        IrqAffinity a;
+        a.irq = irq;
+        out.push_back(a);
+    }
+
+    // /proc/interrupts supplies the action names, and the IRQs themselves for
+    // devices without MSI vectors in sysfs.
+    std::ifstream in(proc_root + "/interrupts");
+    std::string line;
+    while (std::getline(in, line)) {
+        auto colon = line.find(':');
+        if (colon == std::string::npos) continue;
+        std::string head = line.substr(0, colon);
+        head.erase(0, head.find_first_not_of(' '));
+        if (head.empty() || head.find_first_not_of("0123456789") != std::string::npos) continue;
+        const int irq = std::atoi(head.c_str());
+        std::string name;
+        std::istringstream ls(line.substr(colon + 1));
+        for (std::string tok; ls >> tok;) name = tok;  // action name is the last column
+        auto it = std::find_if(out.begin(), out.end(), [&](const IrqAffinity& a) { return a.irq == irq; });
+        if (it != out.end()) it->name = name;
+        else if (irq_belongs_to(name, nic)) out.push_back(IrqAffinity{irq, name, {}});
+    }
+
+    for (auto& a : out) {
+        std::string list;
+        if (read_line(proc_root + "/irq/" + std::to_string(a.irq) + "/smp_affinity_list", list))
+            a.cpus = Topology::parse_cpulist(list);
+    }
+    std::sort(out.begin(), out.end(), [](const IrqAffinity& x, const IrqAffinity& y) { return x.irq < y.irq; });
+    return out;
+}
+
+} // namespace udp
@@ -0,0 +1,101 @@
+
+#include <gtest/gtest.h>
+#include "udp/address.hpp"
+#include "udp/socket.hpp"
+#include "udp/stats.hpp"
+#include <thread>
+
+using namespace udp;
+
+TEST(Address, ParseV4AndV6) {
+    SockAddr a;
+    ASSERT_TRUE(parse_address("10.1.2.3", 9000, a));
+    EXPECT_EQ(a.family(), AF_INET);
+    EXPECT_EQ(a.port(), 9000);
+    EXPECT_EQ(to_string(a), "10.1.2.3:9000");
+
+    SockAddr b;
+    ASSERT_TRUE(parse_address("2001:db8::1", 53, b));
+    EXPECT_EQ(b.family(), AF_INET6);
+    EXPECT_EQ(b.port(), 53);
+    EXPECT_EQ(to_string(b), "[2001:db8::1]:53");
+
+    SockAddr c;
+    EXPECT_FALSE(parse_address("not-an-ip", 1, c));
+    EXPECT_EQ(c.family(), AF_UNSPEC);
+    EXPECT_EQ(c.port(), 0);
+    EXPECT_EQ(to_string(c), "unspec");
+}
+
+TEST(Address, V4MappedKeysMatch) {
+    SockAddr v4, mapped;
+    ASSERT_TRUE(parse_address("192.0.2.7", 4000, v4));
+    ASSERT_TRUE(parse_address("::ffff:192.0.2.7", 4000, mapped));
+    EXPECT_EQ(to_v4_mapped(v4).family(), AF_INET6);
+    EXPECT_TRUE(make_client_key(v4) == make_client_key(mapped));
+    EXPECT_TRUE(make_client_key(v4) == make_client_key(0xC0000207, 4000));
+    EXPECT_EQ(addr_hash(make_client_key(v4)), addr_hash(make_client_key(0xC0000207, 4001)));
+    EXPECT_EQ(ClientKeyHash{}(make_client_key(v4)), ClientKeyHash{}(make_client_key(mapped)));
+}
+
+TEST(Address, StatsTrackV6Clients) {
+    Stats s;
+    SockAddr a, b;
+    ASSERT_TRUE(parse_address("2001:db8::1", 1000, a));
+    ASSERT_TRUE(parse_address("2001:db8::2", 1000, b));
+    s.note_client(make_client_key(a));
+    s.note_client(make_client_key(a));
+    s.note_client(make_client_key(b));
+    s.note_client(0x7f000001, 1000);
+    EXPECT_EQ(s.unique_clients(), 3u);
+}
+
+// Dual-stack socket on the IPv6 loopback; skipped where IPv6 is unavailable.
+TEST(Address, DualStackLoopbackEcho) {
+    std::unique_ptr<UdpSocket> srv;
+    try {
+        srv = std::make_unique<UdpSocket>(4, AddressFamily::Dual);
+        srv->bind(0, false);
+    } catch (const std::exception&) {
+        GTEST_SKIP() << "IPv6 not available";
+    }
+    SockAddr local;
+    socklen_t llen = sizeof(sockaddr_in6);
+    ASSERT_EQ(getsockname(srv->fd(), &local.sa, &llen), 0);
+    local.len = llen;
+
+    UdpSocket cli(4, AddressFamily::V4);
+    cli.connect("127.0.0.1", local.port());
+    std::vector<std::vector<uint8_t>> out(1, std::vector<uint8_t>(16, 0x5A));
+    ASSERT_EQ(cli.send_batch(out, nullptr), 1);
+
+    std::vector<std::vector<uint8_t>> bufs(4, std::vector<uint8_t>(64));
+    std::vector<PacketMeta> meta;
+    ssize_t r = 0;
+    for (int i = 0; i < 100 && r == 0; ++i) {
+        r = srv->recv_batch(bufs, &meta);
+        if (r == 0) std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    ASSERT_EQ(r, 1);
+    EXPECT_EQ(meta[0].len, 16u);
+    EXPECT_EQ(meta[0].peer.family(), AF_INET6);
+    SockAddr cli_v4;
+    ASSERT_TRUE(parse_address("127.0.0.1", meta[0].peer.port(), cli_v4));
+    EXPECT_TRUE(make_client_key(meta[0].peer) == make_client_key(cli_v4));
+
+    // Echo back through the per-packet peer address.
+    std::vector<std::vector<uint8_t>> echo(1, std::vector<uint8_t>(bufs[0].begin(), bufs[0].begin() + 16));
+    ASSERT_EQ(srv->send_batch(echo, &meta), 1);
+    r = 0;
+    for (int i = 0; i < 100 && r == 0; ++i) {
+        r = cli.recv_batch(bufs, nullptr);
+        if (r == 0) std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    EXPECT_EQ(r, 1);
+}
+
+TEST(Address, V6AddressOnV4SocketThrows) {
+    UdpSocket s(1, AddressFamily::V4);
+    EXPECT_THROW(s.connect("::1", 9000), std::runtime_error);
+    EXPECT_THROW(s.connect("bogus", 9000), std::runtime_error);
+}
@@ -0,0 +1,152 @@
+
+#include <gtest/gtest.h>
+#include "udp/autotune.hpp"
+#include "udp/metrics_http.hpp"
+#include "udp/client.hpp"
+#include "udp/server.hpp"
+#include "udp/socket.hpp"
+#include <thread>
+
+using namespace udp;
+
+static AutotuneConfig tuner_cfg() {
+    AutotuneConfig c;
+    c.enabled = true;
+    c.min_batch = 8;
+    c.max_batch = 256;
+    c.interval_ns = 1000;
+    return c;
+}
+
+TEST(Autotune, GrowsWhenFull) {
+    BatchTuner t(tuner_cfg(), 32);
+    t.tick(1, 0);  // opens the first window
+    for (int i = 0; i < 10; ++i) t.on_batch(32, 100);
+    auto d = t.tick(2000, 0);
+    EXPECT_TRUE(d.evaluated);
+    EXPECT_TRUE(d.grew);
+    EXPECT_EQ(d.batch, 64);
+    EXPECT_DOUBLE_EQ(t.last_fill_ratio(), 1.0);
+    // Inside the interval nothing is evaluated.
+    EXPECT_FALSE(t.tick(2500, 0).evaluated);
+}
+
+TEST(Autotune, ShrinksWhenSparseAndClamps) {
+    BatchTuner t(tuner_cfg(), 16);
+    uint64_t now = 1;
+    t.tick(now, 0);
+    for (int round = 0; round < 4; ++round) {
+        t.on_batch(1, 100);
+        now += 2000;
+        t.tick(now, 0);
+    }
+    EXPECT_EQ(t.batch(), 8);
+    // Initial batch outside [min,max] is clamped.
+    EXPECT_EQ(BatchTuner(tuner_cfg(), 100000).batch(), 256);
+}
+
+TEST(Autotune, LatencyTargetShrinksAndBlocksGrowth) {
+    auto cfg = tuner_cfg();
+    cfg.latency_target_ns = 10'000;
+    BatchTuner t(cfg, 64);
+    t.tick(1, 0);
+    t.on_batch(64, 50'000);
+    auto d = t.tick(2001, 0);
+    EXPECT_TRUE(d.shrank);
+    EXPECT_EQ(d.batch, 32);
+    // Full but between target/2 and target: hold.
+    t.on_batch(32, 8'000);
+    d = t.tick(4001, 0);
+    EXPECT_FALSE(d.grew);
+    EXPECT_FALSE(d.shrank);
+}
+
+TEST(Autotune, KernelDropsRaiseRcvbuf) {
+    auto cfg = tuner_cfg();
+    cfg.max_rcvbuf = 4 << 20;
+    BatchTuner t(cfg, 32);
+    t.tick(1, 5);
+    t.on_batch(16, 100);
+    auto d = t.tick(2001, 9);
+    EXPECT_TRUE(d.raise_rcvbuf);
+    EXPECT_TRUE(d.grew);  // drops also push the batch up to drain faster
+    EXPECT_FALSE(t.tick(4001, 9).raise_rcvbuf);
+    EXPECT_EQ(t.next_rcvbuf(1 << 20), 2 << 20);
+    EXPECT_EQ(t.next_rcvbuf(3 << 20), 4 << 20);
+}
+
+TEST(Autotune, SocketReportsEffectiveBuffers) {
+    UdpSocket s(4);
+    s.set_rcvbuf(256 * 1024);
+    s.set_sndbuf(256 * 1024);
+    EXPECT_GT(s.rcvbuf(), 0);
+    EXPECT_GT(s.sndbuf(), 0);
+    EXPECT_EQ(s.rx_dropped(), 0u);
+    MockSocket m;
+    EXPECT_EQ(m.rcvbuf(), 0);
+    EXPECT_EQ(m.rx_dropped(), 0u);
+}
+
+TEST(Autotune, WarnsWhenKernelCapsBuffers) {
+    // The kernel reads back double the request, so 300000 under a 212992 cap
+    // reads back 425984: larger than the request, yet still capped.
+    EXPECT_TRUE(ISocket::buffer_capped(300000, 425984));
+    EXPECT_FALSE(ISocket::buffer_capped(200000, 400000));
+    EXPECT_FALSE(ISocket::buffer_capped(300000, 0));
+
+    ServerConfig scfg;
+    scfg.metrics_port = 0;
+    scfg.verbose = true;
+    scfg.rcvbuf = 300000;
+    auto capped = std::make_unique<MockSocket>();
+    capped->emulate_buffer_cap(212992);
+    testing::internal::CaptureStderr();
+    { UdpServer srv(std::move(capped), scfg); }
+    EXPECT_NE(testing::internal::GetCapturedStderr().find("SO_RCVBUF capped at 212992"), std::string::npos);
+
+    auto roomy = std::make_unique<MockSocket>();
+    roomy->emulate_buffer_cap(1 << 20);
+    testing::internal::CaptureStderr();
+    { UdpServer srv(std::move(roomy), scfg); }
+    EXPECT_EQ(testing::internal::GetCapturedStderr().find("capped"), std::string::npos);
+
+    ClientConfig ccfg;
+    ccfg.verbose = true;
+    ccfg.sndbuf = 300000;
+    auto tx = std::make_unique<MockSocket>();
+    tx->emulate_buffer_cap(212992);
+    testing::internal::CaptureStderr();
+    { UdpClient cli(std::move(tx), ccfg); }
+    EXPECT_NE(testing::internal::GetCapturedStderr().find("SO_SNDBUF capped at 212992"), std::string::npos);
+}
+
+TEST(Autotune, MetricsCollectorsAppended) {
+    Stats st;
+    MetricsHttpServer m(st, 0);
+    m.add_collector([](std::ostream& os) { os << "custom_metric 7\n"; });
+    auto body = m.render();
+    EXPECT_NE(body.find("udp_packets_dropped_total{reason=\"socket_overflow\"} 0"), std::string::npos);
+    EXPECT_NE(body.find("custom_metric 7"), std::string::npos);
+}
+
+TEST(Autotune, ServerGrowsBatchUnderLoad) {
+    ServerConfig cfg;
+    cfg.batch = 8;
+    cfg.metrics_port = 0;
+    cfg.verbose = false;
+    cfg.autotune = tuner_cfg();
+    cfg.autotune.interval_ns = 100'000;
+    auto ms = std::make_unique<MockSocket>();
+    std::vector<uint8_t> pkt(64, 0);
+    for (int i = 0; i < 20000; ++i) ms->preload_recv(pkt);
+    UdpServer srv(std::move(ms), cfg);
+    EXPECT_EQ(srv.batch_size(), 8);
+    srv.start();
+    // The preloaded backlog fills every batch, so the tuner keeps doubling.
+    for (int i = 0; i < 200 && srv.stats().recv() < 20000; ++i)
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    srv.stop();
+    EXPECT_EQ(srv.stats().recv(), 20000u);
+    EXPECT_GT(srv.batch_size(), 8);
+    EXPECT_EQ(srv.rcvbuf_bytes(), 0);
+}
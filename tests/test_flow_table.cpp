@@ -0,0 +1,198 @@
+
+#include <gtest/gtest.h>
+#include "udp/flow_table.hpp"
+#include "udp/timer_wheel.hpp"
+#include "udp/client.hpp"
+#include "udp/server.hpp"
+#include <arpa/inet.h>
+#include <random>
+#include <thread>
+
+using namespace udp;
+
+static ClientKey key(uint32_t addr, uint16_t port) { return make_client_key(addr, port); }
+
+TEST(TimerWheel, FiresEachTimerOnItsTickAcrossLevels) {
+    // tick = 1 ns so deadlines are exact tick numbers.
+    const size_t n = 5000;
+    TimerWheel w(n, 1, 0);
+    std::mt19937_64 rng(3);
+    std::vector<uint64_t> due(n);
+    for (uint32_t id = 0; id < n; ++id) {
+        due[id] = 1 + rng() % 262000;  // all four levels, within the exact span
+        w.schedule(id, due[id]);
+    }
+    EXPECT_EQ(w.armed_count(), n);
+    std::vector<uint64_t> fired_at(n, 0);
+    uint64_t prev = 0;
+    for (uint64_t now = 997; prev < 262000; prev = now, now += 997) {
+        w.advance(now, [&](uint32_t id) { fired_at[id] = now; });
+        for (uint32_t id = 0; id < n; ++id) {
+            if (due[id] > prev && due[id] <= now) {
+                ASSERT_EQ(fired_at[id], now) << "id " << id;
+            }
+        }
+    }
+    EXPECT_EQ(w.armed_count(), 0u);
+}
+
+TEST(TimerWheel, ClampsDeadlinesBeyondItsSpan) {
+    TimerWheel w(1, 1, 0);
+    w.schedule(0, 10'000'000);
+    uint64_t fired_at = 0;
+    for (uint64_t now = 1000; !fired_at && now < 10'000'000; now += 1000)
+        w.advance(now, [&](uint32_t) { fired_at = now; });
+    // Fires early (callers re-check and re-arm), but never before the span.
+    EXPECT_GT(fired_at, 200'000u);
+    EXPECT_LT(fired_at, 10'000'000u);
+}
+
+TEST(TimerWheel, CancelAndRescheduleFromCallback) {
+    TimerWheel w(4, 10, 0);
+    w.schedule(0, 50);
+    w.schedule(1, 50);
+    w.cancel(1);
+    EXPECT_FALSE(w.armed(1));
+    int fires = 0;
+    w.advance(60, [&](uint32_t id) {
+        EXPECT_EQ(id, 0u);
+        if (++fires == 1) w.schedule(id, 200);
+    });
+    EXPECT_EQ(fires, 1);
+    EXPECT_TRUE(w.armed(0));
+    w.advance(150, [&](uint32_t) { ++fires; });
+    EXPECT_EQ(fires, 1);
+    w.advance(200, [&](uint32_t) { ++fires; });
+    EXPECT_EQ(fires, 2);
+}
+
+TEST(FlowTable, TracksPacketsAndExpiresIdleFlows) {
+    FlowCounters c;
+    FlowConfig cfg;
+    cfg.capacity = 16;
+    cfg.idle_timeout_ns = 1'000'000;  // 1 ms
+    cfg.tick_ns = 100'000;
+    FlowTable t(cfg, 0, &c);
+
+    ASSERT_NE(t.observe(key(1, 10), 100, 0, 0), nullptr);
+    t.observe(key(1, 10), 50, 0, 400'000);
+    t.observe(key(2, 10), 10, 0, 400'000);
+    const FlowState* f = t.find(key(1, 10));
+    ASSERT_NE(f, nullptr);
+    EXPECT_EQ(f->packets, 2u);
+    EXPECT_EQ(f->bytes, 150u);
+    EXPECT_EQ(f->first_seen_ns, 0u);
+    EXPECT_EQ(f->last_seen_ns, 400'000u);
+    EXPECT_EQ(t.active(), 2u);
+    EXPECT_EQ(c.active.load(), 2);
+
+    // Flow 1 keeps talking, flow 2 goes quiet.
+    t.observe(key(1, 10), 50, 0, 1'200'000);
+    EXPECT_EQ(t.expire(1'300'000), 0u);
+    EXPECT_EQ(t.expire(1'500'000), 1u);
+    EXPECT_EQ(t.find(key(2, 10)), nullptr);
+    EXPECT_NE(t.find(key(1, 10)), nullptr);
+    EXPECT_EQ(t.expire(2'300'000), 1u);
+    EXPECT_EQ(t.active(), 0u);
+    EXPECT_EQ(c.created.load(), 2u);
+    EXPECT_EQ(c.expired.load(), 2u);
+    EXPECT_EQ(c.active.load(), 0);
+}
+
+TEST(FlowTable, RejectsNewFlowsWhenFull) {
+    FlowCounters c;
+    FlowConfig cfg;
+    cfg.capacity = 4;
+    FlowTable t(cfg, 0, &c);
+    for (uint16_t p = 0; p < 4; ++p) ASSERT_NE(t.observe(key(1, p), 1, 0, 0), nullptr);
+    EXPECT_EQ(t.observe(key(1, 99), 1, 0, 0), nullptr);
+    EXPECT_NE(t.observe(key(1, 3), 1, 0, 0), nullptr);  // existing flows still update
+    EXPECT_EQ(c.rejected.load(), 1u);
+    t.clear();
+    EXPECT_EQ(c.active.load(), 0);
+    EXPECT_NE(t.observe(key(1, 99), 1, 0, 0), nullptr);
+}
+
+TEST(FlowTable, LossWindowSeparatesLossFromReordering) {
+    FlowTable t(FlowConfig{}, 0, nullptr);
+    const ClientKey k = key(7, 7);
+    for (uint64_t s : {1, 2, 3, 5, 6, 4, 6}) t.observe(k, 1, s, 0);
+    const FlowState* f = t.find(k);
+    EXPECT_EQ(f->lost, 0u);        // 4 arrived late, within the window
+    EXPECT_EQ(f->reordered, 1u);
+    EXPECT_EQ(f->duplicates, 1u);
+    // Skip 7; the gap becomes loss once it slides out of the 64-packet window.
+    for (uint64_t s = 8; s < 70; ++s) t.observe(k, 1, s, 0);
+    EXPECT_EQ(f->lost, 0u);
+    for (uint64_t s = 70; s < 80; ++s) t.observe(k, 1, s, 0);
+    EXPECT_EQ(f->lost, 1u);
+    // Jumps ahead count every skipped sequence number that has left the
+    // window; the 63 just below the newest one are still pending.
+    t.observe(k, 1, 1000, 0);
+    t.observe(k, 1, 1100, 0);
+    EXPECT_EQ(f->lost, 1u + (1000 - 80) + (1100 - 1001) - 63);
+}
+
+TEST(FlowTable, StaysBoundedUnderEphemeralChurn) {
+    FlowCounters c;
+    FlowConfig cfg;
+    cfg.capacity = 1024;
+    cfg.idle_timeout_ns = 1'000'000;
+    cfg.tick_ns = 100'000;
+    FlowTable t(cfg, 0, &c);
+    uint64_t now = 0;
+    for (uint32_t i = 0; i < 500'000; ++i) {
+        now += 5'000;  // 200k new flows per second, each seen once
+        t.observe(key(0x0a000000u + (i >> 16), static_cast<uint16_t>(i)), 64, 0, now);
+        t.expire(now);
+        ASSERT_LE(t.active(), cfg.capacity);
+    }
+    EXPECT_EQ(c.rejected.load(), 0u);
+    EXPECT_EQ(c.created.load() - c.expired.load(), t.active());
+    // The most recent flow is still found after heavy deletion churn.
+    EXPECT_NE(t.find(key(0x0a000000u + (499'999u >> 16), static_cast<uint16_t>(499'999u))), nullptr);
+}
+
+TEST(FlowTable, EachFlowStaysOnOneWorker) {
+    ServerConfig scfg;
+    scfg.port = 0;
+    scfg.workers = 2;
+    scfg.metrics_port = 0;
+    scfg.verbose = false;
+    UdpServer srv(std::make_unique<UdpSocket>(64), scfg);
+    srv.start();
+    // Every worker reads its own member of the reuseport group.
+    ASSERT_EQ(srv.socket_fds().size(), 2u);
+    SockAddr local;
+    socklen_t len = sizeof(sockaddr_in6);
+    ASSERT_EQ(getsockname(srv.socket().fd(), &local.sa, &len), 0);
+
+    const int kClients = 8;
+    std::vector<std::unique_ptr<UdpClient>> clients;
+    for (int i = 0; i < kClients; ++i) {
+        ClientConfig c;
+        c.port = ntohs(local.v4.sin_port);
+        c.pps = 10000;
+        c.seconds = 1;
+        c.id = i;
+        clients.push_back(std::make_unique<UdpClient>(std::make_unique<UdpSocket>(64), c));
+    }
+    for (auto& c : clients) c->start();
+    uint64_t sent = 0;
+    for (auto& c : clients) {
+        c->join();
+        sent += c->stats().sent();
+    }
+    for (int i = 0; i < 500 && srv.stats().recv() < sent; ++i)
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    srv.stop();
+
+    ASSERT_EQ(srv.stats().recv(), sent);
+    const FlowCounters& f = srv.stats().flows();
+    // One table entry per client, and each table saw its flows' whole sequence space.
+    EXPECT_EQ(f.created.load(), static_cast<uint64_t>(kClients));
+    EXPECT_EQ(f.lost.load(), 0u);
+    EXPECT_EQ(f.reordered.load(), 0u);
+    EXPECT_EQ(f.duplicates.load(), 0u);
+    EXPECT_EQ(srv.stats().unique_clients(), static_cast<size_t>(kClients));
+}
@@ -0,0 +1,156 @@
+
+#include <gtest/gtest.h>
+#include "udp/loopback.hpp"
+#include "udp/client.hpp"
+#include "udp/server.hpp"
+#include "udp/common.hpp"
+#include <thread>
+
+using namespace udp;
+
+static std::vector<std::vector<uint8_t>> seq_batch(uint64_t first, size_t n) {
+    std::vector<std::vector<uint8_t>> out(n, std::vector<uint8_t>(sizeof(PacketHeader), 0));
+    for (size_t i = 0; i < n; ++i) {
+        auto* h = reinterpret_cast<PacketHeader*>(out[i].data());
+        h->seq = first + i;
+        h->magic = kMagic;
+    }
+    return out;
+}
+
+static std::vector<uint64_t> drain_seqs(LoopbackSocket& s) {
+    std::vector<std::vector<uint8_t>> bufs(64, std::vector<uint8_t>(2048));
+    std::vector<uint64_t> seqs;
+    ssize_t r;
+    while ((r = s.recv_batch(bufs)) > 0) {
+        for (ssize_t i = 0; i < r; ++i) seqs.push_back(reinterpret_cast<PacketHeader*>(bufs[i].data())->seq);
+    }
+    return seqs;
+}
+
+// Sends seq 0..9999 over an impaired link and returns what arrived, in order.
+static std::vector<uint64_t> run_impaired(const LinkImpairment& imp,
+                                          std::shared_ptr<LoopbackChannel>* link = nullptr) {
+    auto p = make_loopback_pair(imp, {}, 1 << 15);
+    for (uint64_t s = 0; s < 10000; s += 100) p.a->send_batch(seq_batch(s, 100));
+    if (link) *link = p.a_to_b;
+    return drain_seqs(*p.b);
+}
+
+TEST(Loopback, CleanLinkDeliversInOrder) {
+    auto p = make_loopback_pair();
+    p.a->send_batch(seq_batch(1, 10));
+    std::vector<std::vector<uint8_t>> bufs(16, std::vector<uint8_t>(2048));
+    std::vector<PacketMeta> meta;
+    ASSERT_EQ(p.b->recv_batch(bufs, &meta), 10);
+    for (int i = 0; i < 10; ++i) {
+        EXPECT_EQ(reinterpret_cast<PacketHeader*>(bufs[i].data())->seq, uint64_t(i + 1));
+        EXPECT_EQ(meta[i].len, sizeof(PacketHeader));
+        EXPECT_EQ(meta[i].peer.port(), 40000);
+    }
+    // Reply path carries the server's bound port.
+    p.b->bind(9100, false);
+    p.b->send_batch(seq_batch(1, 1));
+    ASSERT_EQ(p.a->recv_batch(bufs, &meta), 1);
+    EXPECT_EQ(meta[0].peer.port(), 9100);
+}
+
+TEST(Loopback, ImpairmentsAreDeterministic) {
+    LinkImpairment imp;
+    imp.loss = 0.1;
+    imp.duplicate = 0.05;
+    imp.reorder = 0.05;
+    imp.seed = 42;
+    std::shared_ptr<LoopbackChannel> c;
+    auto first = run_impaired(imp, &c);
+    auto second = run_impaired(imp);
+    EXPECT_EQ(first, second);
+
+    EXPECT_EQ(c->sent(), 10000u);
+    EXPECT_EQ(c->overflowed(), 0u);
+    // Nothing stays in flight, not even a datagram held back at the very end.
+    EXPECT_EQ(c->sent() - c->lost() + c->duplicated(), first.size());
+    EXPECT_EQ(c->delivered(), first.size());
+    EXPECT_NEAR(static_cast<double>(c->lost()), 1000.0, 150.0);
+    EXPECT_GT(c->duplicated(), 0u);
+    EXPECT_GT(c->reordered(), 0u);
+    size_t inversions = 0;
+    for (size_t i = 1; i < first.size(); ++i) inversions += first[i] < first[i - 1];
+    EXPECT_GE(inversions, c->reordered() / 2);
+
+    imp.seed = 43;
+    EXPECT_NE(run_impaired(imp), first);
+}
+
+TEST(Loopback, HeldDatagramIsFlushedWhenLinkDrains) {
+    LinkImpairment imp;
+    imp.reorder = 1.0;  // hold back the first datagram of every pair
+    auto p = make_loopback_pair(imp);
+    p.a->send_batch(seq_batch(1, 3));
+    // 1 is held, 2 releases it, 3 is held with nothing behind it.
+    EXPECT_EQ(drain_seqs(*p.b), (std::vector<uint64_t>{2, 1, 3}));
+    EXPECT_EQ(p.a_to_b->delivered(), 3u);
+    EXPECT_EQ(p.a_to_b->reordered(), 1u);
+}
+
+TEST(Loopback, DelayHoldsDatagramsAndStampsArrival) {
+    LinkImpairment imp;
+    imp.delay_ns = 5'000'000;
+    auto p = make_loopback_pair(imp);
+    ASSERT_TRUE(p.b->enable_timestamps(true, false));
+    EXPECT_FALSE(p.b->enable_timestamps(true, true));
+    const uint64_t sent_at = wall_ns();
+    p.a->send_batch(seq_batch(1, 4));
+    std::vector<std::vector<uint8_t>> bufs(8, std::vector<uint8_t>(2048));
+    std::vector<PacketMeta> meta;
+    EXPECT_EQ(p.b->recv_batch(bufs, &meta), 0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    ASSERT_EQ(p.b->recv_batch(bufs, &meta), 4);
+    EXPECT_GE(meta[0].rx_ts_ns, sent_at + imp.delay_ns);
+}
+
+TEST(Loopback, FullRingCountsAsSocketOverflow) {
+    auto p = make_loopback_pair({}, {}, 8);
+    p.a->send_batch(seq_batch(1, 20));
+    EXPECT_EQ(p.b->rx_dropped(), 12u);
+    EXPECT_EQ(drain_seqs(*p.b).size(), 8u);
+}
+
+TEST(Loopback, ClientServerEndToEnd) {
+    LinkImpairment imp;
+    imp.loss = 0.2;
+    imp.delay_ns = 200'000;
+    imp.seed = 7;
+    auto p = make_loopback_pair(imp, {}, 1 << 16);
+    auto link = p.a_to_b;
+
+    ServerConfig scfg;
+    scfg.batch = 64;
+    scfg.metrics_port = 0;
+    scfg.verbose = false;
+    scfg.timestamps = true;
+    UdpServer srv(std::move(p.b), scfg);
+    srv.start();
+
+    ClientConfig ccfg;
+    ccfg.pps = 200000;
+    ccfg.seconds = 1;
+    ccfg.batch = 64;
+    UdpClient cli(std::move(p.a), ccfg);
+    cli.start();
+    cli.join();
+
+    const uint64_t expect = cli.stats().sent() - link->lost();
+    for (int i = 0; i < 500 && srv.stats().recv() < expect; ++i)
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    srv.stop();
+
+    EXPECT_EQ(link->sent(), cli.stats().sent());
+    EXPECT_EQ(srv.stats().recv(), expect);
+    EXPECT_NEAR(static_cast<double>(link->lost()) / link->sent(), 0.2, 0.02);
+    const auto& net = srv.stats().latency(LatencyStage::Network);
+    ASSERT_GT(net.count(), 0u);
+    EXPECT_GE(net.percentile(0.5), imp.delay_ns);
+    // Processing is per packet, not per batch.
+    EXPECT_EQ(srv.stats().latency(LatencyStage::Processing).count(), srv.stats().recv());
+}
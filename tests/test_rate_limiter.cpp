@@ -0,0 +1,121 @@
+
+#include <gtest/gtest.h>
+#include "udp/rate_limiter.hpp"
+#include "udp/server.hpp"
+#include "udp/socket.hpp"
+#include "udp/common.hpp"
+#include <thread>
+
+using namespace udp;
+
+TEST(RateLimiter, DisabledAdmitsEverything) {
+    RateLimiter rl(RateLimitConfig{});
+    EXPECT_FALSE(rl.enabled());
+    for (int i = 0; i < 1000; ++i) EXPECT_EQ(rl.admit(1, 0), RateLimiter::Verdict::Admit);
+    EXPECT_EQ(rl.tracked(), 0u);
+}
+
+TEST(RateLimiter, PerClientBurstThenRefill) {
+    RateLimitConfig cfg;
+    cfg.client_pps = 1000;   // 1 packet per ms
+    cfg.client_burst = 10;
+    RateLimiter rl(cfg);
+    const uint64_t t0 = 1'000'000'000ull;
+    int admitted = 0;
+    for (int i = 0; i < 20; ++i)
+        if (rl.admit(42, t0) == RateLimiter::Verdict::Admit) ++admitted;
+    EXPECT_EQ(admitted, 10);
+    EXPECT_EQ(rl.admit(42, t0), RateLimiter::Verdict::ClientLimited);
+    // Another source has its own bucket.
+    EXPECT_EQ(rl.admit(43, t0), RateLimiter::Verdict::Admit);
+    // One interval later exactly one more token is available.
+    EXPECT_EQ(rl.admit(42, t0 + 1'000'000), RateLimiter::Verdict::Admit);
+    EXPECT_EQ(rl.admit(42, t0 + 1'000'000), RateLimiter::Verdict::ClientLimited);
+    EXPECT_EQ(rl.tracked(), 2u);
+}
+
+TEST(RateLimiter, GlobalCeiling) {
+    RateLimitConfig cfg;
+    cfg.global_pps = 100;
+    cfg.global_burst = 5;
+    RateLimiter rl(cfg);
+    int admitted = 0;
+    for (uint32_t a = 0; a < 50; ++a)
+        if (rl.admit(a, 1000) == RateLimiter::Verdict::Admit) ++admitted;
+    EXPECT_EQ(admitted, 5);
+    EXPECT_EQ(rl.admit(99, 1000), RateLimiter::Verdict::GlobalLimited);
+}
+
+TEST(RateLimiter, GlobalDropDoesNotChargeClient) {
+    RateLimitConfig cfg;
+    cfg.client_pps = 1000;
+    cfg.client_burst = 2;
+    cfg.global_pps = 1000;
+    cfg.global_burst = 1;
+    RateLimiter rl(cfg);
+    EXPECT_EQ(rl.admit(7, 0), RateLimiter::Verdict::Admit);
+    EXPECT_EQ(rl.admit(7, 0), RateLimiter::Verdict::GlobalLimited);
+    // Client still holds its second token once the global bucket refills.
+    EXPECT_EQ(rl.admit(7, 1'000'000), RateLimiter::Verdict::Admit);
+}
+
+TEST(RateLimiter, BoundedTableEvicts) {
+    RateLimitConfig cfg;
+    cfg.client_pps = 10;
+    cfg.table_size = 16;
+    RateLimiter rl(cfg);
+    EXPECT_EQ(rl.capacity(), 16u);
+    // One second apart, so every earlier bucket has refilled and may be recycled.
+    for (uint32_t a = 1; a <= 1000; ++a) rl.admit(a, a * 1'000'000'000ull);
+    EXPECT_LE(rl.tracked(), rl.capacity());
+    EXPECT_GT(rl.evictions(), 0u);
+    EXPECT_EQ(rl.overflowed(), 0u);
+}
+
+TEST(RateLimiter, ThrottledBucketsSurviveSourceRotation) {
+    RateLimitConfig cfg;
+    cfg.client_pps = 1000;
+    cfg.client_burst = 2;
+    cfg.table_size = 8;  // one probe window covers the whole table
+    RateLimiter rl(cfg);
+    const uint64_t t0 = 1'000'000'000ull;
+    EXPECT_EQ(rl.admit(1, t0), RateLimiter::Verdict::Admit);
+    EXPECT_EQ(rl.admit(1, t0), RateLimiter::Verdict::Admit);
+    EXPECT_EQ(rl.admit(1, t0), RateLimiter::Verdict::ClientLimited);
+    // Spoofed sources fill the table and then overflow; none may recycle
+    // source 1's bucket while it is still in debt.
+    for (uint64_t a = 100; a < 200; ++a) rl.admit(a, t0);
+    EXPECT_EQ(rl.evictions(), 0u);
+    EXPECT_GT(rl.overflowed(), 0u);
+    EXPECT_EQ(rl.admit(1, t0), RateLimiter::Verdict::ClientLimited);
+    // The overflow bucket itself is rate limited like any single source.
+    EXPECT_EQ(rl.admit(500, t0), RateLimiter::Verdict::ClientLimited);
+    // Source 1 refills on its own schedule.
+    EXPECT_EQ(rl.admit(1, t0 + 1'000'000), RateLimiter::Verdict::Admit);
+}
+
+TEST(RateLimiter, ServerDropsOverLimit) {
+    auto ms = std::make_unique<MockSocket>();
+    std::vector<uint8_t> pkt(64, 0);
+    auto* hdr = reinterpret_cast<PacketHeader*>(pkt.data());
+    hdr->seq = 1; hdr->send_ts_ns = now_ns(); hdr->magic = kMagic;
+    SockAddr peer;
+    ASSERT_TRUE(parse_address("127.0.0.1", 5000, peer));
+    for (int i = 0; i < 8; ++i) ms->preload_recv(pkt, peer);
+
+    ServerConfig cfg;
+    cfg.batch = 8;
+    cfg.metrics_port = 0;
+    cfg.verbose = false;
+    cfg.rate_limit.client_pps = 1;
+    cfg.rate_limit.client_burst = 3;
+    UdpServer srv(std::move(ms), cfg);
+    srv.start();
+    for (int i = 0; i < 100 && srv.stats().recv() < 8; ++i)
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    srv.stop();
+    EXPECT_EQ(srv.stats().recv(), 8u);
+    EXPECT_EQ(srv.stats().dropped(DropReason::ClientRate), 5u);
+    EXPECT_EQ(srv.stats().dropped(DropReason::GlobalRate), 0u);
+    EXPECT_EQ(srv.stats().unique_clients(), 1u);
+}
@@ -0,0 +1,343 @@
+
+#include <gtest/gtest.h>
+#include "udp/config.hpp"
+#include "udp/handoff.hpp"
+#include "udp/server.hpp"
+#include "udp/socket.hpp"
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <thread>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace udp;
+
+static std::string temp_path(const char* tag) {
+    return "/tmp/udp_test_" + std::string(tag) + "_" + std::to_string(::getpid());
+}
+
+TEST(Reload, ApplyOptions) {
+    ServerConfig cfg;
+    EXPECT_TRUE(server_option_takes_value("batch"));
+    EXPECT_FALSE(server_option_takes_value("echo"));
+    EXPECT_TRUE(apply_server_option(cfg, "workers", "4"));
+    EXPECT_TRUE(apply_server_option(cfg, "family", "dual"));
+    EXPECT_TRUE(apply_server_option(cfg, "latency-target-us", "50"));
+    EXPECT_TRUE(apply_server_option(cfg, "echo", ""));
+    EXPECT_FALSE(apply_server_option(cfg, "no-such-option", "1"));
+    EXPECT_EQ(cfg.workers, 4);
+    EXPECT_EQ(cfg.family, AddressFamily::Dual);
+    EXPECT_EQ(cfg.autotune.latency_target_ns, 50'000u);
+    EXPECT_TRUE(cfg.echo);
+    EXPECT_TRUE(apply_server_option(cfg, "echo", "false"));
+    EXPECT_FALSE(cfg.echo);
+    EXPECT_TRUE(apply_server_option(cfg, "quiet", "0"));
+    EXPECT_TRUE(cfg.verbose);
+}
+
+TEST(Reload, BadValuesAreRejected) {
+    ServerConfig cfg;
+    EXPECT_THROW(apply_server_option(cfg, "workers", "abc"), std::runtime_error);
+    EXPECT_THROW(apply_server_option(cfg, "workers", "0"), std::runtime_error);
+    EXPECT_THROW(apply_server_option(cfg, "batch", "12x"), std::runtime_error);
+    EXPECT_THROW(apply_server_option(cfg, "port", "70000"), std::runtime_error);
+    EXPECT_THROW(apply_server_option(cfg, "client-pps", "-5"), std::runtime_error);
+    EXPECT_THROW(apply_server_option(cfg, "flow-idle-ms", "99999999999999999999"), std::runtime_error);
+    EXPECT_THROW(apply_server_option(cfg, "family", "ipv6"), std::runtime_error);
+    EXPECT_THROW(apply_server_option(cfg, "echo", "maybe"), std::runtime_error);
+    EXPECT_EQ(cfg.workers, ServerConfig{}.workers);
+    EXPECT_EQ(cfg.family, AddressFamily::V4);
+
+    auto path = temp_path("cfg_bad");
+    {
+        std::ofstream f(path);
+        f << "batch 64\nworkers = abc\n";
+    }
+    std::string err;
+    EXPECT_FALSE(load_server_config(path, cfg, err));
+    EXPECT_NE(err.find(":2: invalid value 'abc' for 'workers'"), std::string::npos) << err;
+    {
+        std::ofstream f(path);
+        f << "echo = 1\ntimestamps = 0\nreuseport = false\n";
+    }
+    cfg.timestamps = true;
+    ASSERT_TRUE(load_server_config(path, cfg, err)) << err;
+    EXPECT_TRUE(cfg.echo);
+    EXPECT_FALSE(cfg.timestamps);
+    std::remove(path.c_str());
+}
+
+TEST(Reload, LoadConfigFile) {
+    auto path = temp_path("cfg");
+    {
+        std::ofstream f(path);
+        f << "# comment\n\nbatch = 128\nworkers 3\nclient-pps=500 # trailing\nquiet\n";
+    }
+    ServerConfig cfg;
+    std::string err;
+    ASSERT_TRUE(load_server_config(path, cfg, err)) << err;
+    EXPECT_EQ(cfg.batch, 128);
+    EXPECT_EQ(cfg.workers, 3);
+    EXPECT_EQ(cfg.rate_limit.client_pps, 500u);
+    EXPECT_FALSE(cfg.verbose);
+
+    {
+        std::ofstream f(path);
+        f << "batch\n";
+    }
+    EXPECT_FALSE(load_server_config(path, cfg, err));
+    EXPECT_NE(err.find(":1:"), std::string::npos);
+    EXPECT_NE(err.find("needs a value"), std::string::npos);
+
+    // Unknown keys, bad flag values and extra values are errors, not ignored.
+    for (const char* bad : {"batch 64\nbach 32\n", "echo = maybe\n", "port 9000 9001\n"}) {
+        {
+            std::ofstream f(path);
+            f << bad;
+        }
+        EXPECT_FALSE(load_server_config(path, cfg, err)) << bad;
+    }
+    EXPECT_NE(err.find("unexpected value"), std::string::npos);
+    {
+        std::ofstream f(path);
+        f << "batch 64\nbach 32\n";
+    }
+    EXPECT_FALSE(load_server_config(path, cfg, err));
+    EXPECT_NE(err.find(":2: unknown option 'bach'"), std::string::npos) << err;
+    std::remove(path.c_str());
+    EXPECT_FALSE(load_server_config(path, cfg, err));
+}
+
+TEST(Reload, OnlyReloadableFieldsAreAdopted) {
+    ServerConfig running;
+    running.port = 9000;
+    running.workers = 1;
+    running.batch = 64;
+    ServerConfig loaded = running;
+    ASSERT_TRUE(apply_server_option(loaded, "workers", "4"));
+    ASSERT_TRUE(apply_server_option(loaded, "batch", "128"));
+    ASSERT_TRUE(apply_server_option(loaded, "port", "9001"));
+    ASSERT_TRUE(apply_server_option(loaded, "client-pps", "500"));
+    ASSERT_TRUE(apply_server_option(loaded, "timestamps", ""));
+
+    auto rejected = apply_reloadable(running, loaded);
+    EXPECT_EQ(rejected, (std::vector<std::string>{"port", "client-pps", "timestamps"}));
+    EXPECT_EQ(running.workers, 4);
+    EXPECT_EQ(running.batch, 128);
+    EXPECT_EQ(running.port, 9000);
+    EXPECT_EQ(running.rate_limit.client_pps, 0u);
+    EXPECT_FALSE(running.timestamps);
+    EXPECT_EQ(server_option_value(loaded, "port"), "9001");
+    EXPECT_EQ(server_option_value(loaded, "timestamps"), "1");
+    EXPECT_TRUE(apply_reloadable(running, running).empty());
+}
+
+TEST(Reload, ResizeWorkersAndBatchInPlace) {
+    ServerConfig cfg;
+    cfg.batch = 16;
+    cfg.metrics_port = 0;
+    cfg.verbose = false;
+    cfg.reloadable = true;
+    UdpServer srv(std::make_unique<UdpSocket>(16), cfg);
+    srv.start();
+    EXPECT_EQ(srv.worker_count(), 1u);
+
+    ServerConfig next = cfg;
+    next.workers = 3;
+    next.batch = 32;
+    EXPECT_TRUE(srv.reconfigure(next));
+    EXPECT_EQ(srv.worker_count(), 3u);
+    // Each added worker reads its own member of the reuseport group.
+    EXPECT_EQ(srv.socket_fds().size(), 3u);
+    for (int i = 0; i < 100 && srv.batch_size() != 32; ++i)
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    EXPECT_EQ(srv.batch_size(), 32);
+
+    next.workers = 1;
+    srv.reconfigure(next);
+    EXPECT_EQ(srv.worker_count(), 1u);
+    srv.stop();
+    EXPECT_EQ(srv.worker_count(), 0u);
+}
+
+TEST(Reload, WorkersCannotGrowWithoutReuseportGroup) {
+    ServerConfig cfg;
+    cfg.batch = 16;
+    cfg.metrics_port = 0;
+    cfg.verbose = false;
+    UdpServer srv(std::make_unique<UdpSocket>(16), cfg);  // one worker, not reloadable
+    srv.start();
+    ServerConfig next = cfg;
+    next.workers = 3;
+    EXPECT_FALSE(srv.reconfigure(next));
+    EXPECT_EQ(srv.worker_count(), 1u);
+    EXPECT_EQ(srv.socket_fds().size(), 1u);
+    srv.stop();
+}
+
+TEST(Reload, HandoffPassesBoundSocket) {
+    auto path = temp_path("handoff");
+    UdpSocket orig(4);
+    orig.bind(0, false);
+    ASSERT_TRUE(orig.bound());
+    SockAddr local;
+    socklen_t llen = sizeof(sockaddr_in6);
+    ASSERT_EQ(getsockname(orig.fd(), &local.sa, &llen), 0);
+    local.len = llen;
+
+    HandoffServer hs(path, {orig.fd()});
+    hs.start();
+    EXPECT_FALSE(hs.handed_off());
+
+    HandoffClient hc(path);
+    auto fds = hc.receive();
+    ASSERT_EQ(fds.size(), 1u);
+    auto adopted = UdpSocket::adopt(fds[0], 4);
+    EXPECT_TRUE(adopted->bound());
+
+    // A datagram sent to the original port is readable through the adopted fd.
+    UdpSocket cli(4);
+    cli.connect("127.0.0.1", local.port());
+    std::vector<std::vector<uint8_t>> out(1, std::vector<uint8_t>(8, 0x11));
+    ASSERT_EQ(cli.send_batch(out, nullptr), 1);
+    std::vector<std::vector<uint8_t>> bufs(4, std::vector<uint8_t>(64));
+    ssize_t r = 0;
+    for (int i = 0; i < 100 && r == 0; ++i) {
+        r = adopted->recv_batch(bufs, nullptr);
+        if (r == 0) std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    EXPECT_EQ(r, 1);
+
+    hc.ack();
+    for (int i = 0; i < 200 && !hs.handed_off(); ++i)
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    EXPECT_TRUE(hs.handed_off());
+    hs.stop();
+    // After a handoff the path is left for the successor.
+    EXPECT_EQ(::access(path.c_str(), F_OK), 0);
+    ::unlink(path.c_str());
+}
+
+TEST(Reload, HandoffPassesEveryWorkerSocket) {
+    // More fds than any fixed control buffer the successor might guess.
+    auto path = temp_path("handoff_many");
+    UdpSocket orig(4);
+    orig.bind(0, false);
+    std::vector<int> fds;
+    for (int i = 0; i < 40; ++i) fds.push_back(::dup(orig.fd()));
+    HandoffServer hs(path, fds);
+    hs.start();
+    HandoffClient hc(path);
+    auto got = hc.receive();
+    EXPECT_EQ(got.size(), fds.size());
+    hc.ack();
+    hs.stop();
+    for (int fd : got) ::close(fd);
+    for (int fd : fds) ::close(fd);
+    ::unlink(path.c_str());
+}
+
+TEST(Reload, HandoffWithMissingFdsFails) {
+    // A predecessor that announces fewer fds than it attaches: the control
+    // message is truncated and the successor must refuse the partial set.
+    auto path = temp_path("handoff_trunc");
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    int ls = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    ::unlink(path.c_str());
+    ASSERT_EQ(::bind(ls, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)), 0);
+    ASSERT_EQ(::listen(ls, 1), 0);
+    std::thread peer([&] {
+        int c = ::accept(ls, nullptr, nullptr);
+        char hdr[5] = {'N', 1, 0, 0, 0};
+        ::send(c, hdr, sizeof(hdr), 0);
+        int fds[3] = {0, 1, 2};
+        char tag = 'F';
+        iovec iov{&tag, 1};
+        std::vector<char> ctrl(CMSG_SPACE(sizeof(fds)));
+        msghdr mh{};
+        mh.msg_iov = &iov;
+        mh.msg_iovlen = 1;
+        mh.msg_control = ctrl.data();
+        mh.msg_controllen = ctrl.size();
+        cmsghdr* cm = CMSG_FIRSTHDR(&mh);
+        cm->cmsg_level = SOL_SOCKET;
+        cm->cmsg_type = SCM_RIGHTS;
+        cm->cmsg_len = CMSG_LEN(sizeof(fds));
+        std::memcpy(CMSG_DATA(cm), fds, sizeof(fds));
+        ::sendmsg(c, &mh, 0);
+        char ack;
+        ::recv(c, &ack, 1, 0);
+        ::close(c);
+    });
+    {
+        HandoffClient hc(path);
+        EXPECT_THROW(hc.receive(), std::runtime_error);
+    }
+    peer.join();
+    ::close(ls);
+    ::unlink(path.c_str());
+}
+
+TEST(Reload, HandoffErrors) {
+    EXPECT_THROW(HandoffClient("/tmp/udp_test_no_such_socket"), std::runtime_error);
+    EXPECT_THROW(HandoffServer(std::string(200, 'x'), {}).start(), std::runtime_error);
+    int fds[2];
+    ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    EXPECT_THROW(UdpSocket::adopt(fds[0]), std::runtime_error);
+    ::close(fds[0]);
+    ::close(fds[1]);
+}
+
+TEST(Reload, PredecessorExitsAfterHandoffWithMetricsOn) {
+    // Mirrors udp_server's handoff path in a child process: once the successor
+    // acks, the predecessor must stop and exit even though nobody scrapes it.
+    auto path = temp_path("handoff_exit");
+    pid_t pid = ::fork();
+    ASSERT_GE(pid, 0);
+    if (pid == 0) {
+        ServerConfig cfg;
+        cfg.batch = 16;
+        cfg.metrics_port = static_cast<uint16_t>(20000 + ::getpid() % 20000);
+        cfg.verbose = false;
+        UdpServer srv(std::make_unique<UdpSocket>(16), cfg);
+        srv.start();
+        HandoffServer hs(path, srv.socket_fds());
+        hs.start();
+        while (!hs.handed_off()) std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        srv.stop();
+        hs.stop();
+        ::_exit(0);
+    }
+    std::unique_ptr<HandoffClient> hc;
+    for (int i = 0; i < 200 && !hc; ++i) {
+        try {
+            hc = std::make_unique<HandoffClient>(path);
+        } catch (const std::runtime_error&) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+    }
+    ASSERT_TRUE(hc);
+    auto fds = hc->receive();
+    hc->ack();
+
+    int status = 0;
+    pid_t done = 0;
+    for (int i = 0; i < 400 && done == 0; ++i) {
+        done = ::waitpid(pid, &status, WNOHANG);
+        if (done == 0) std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    if (done == 0) {
+        ::kill(pid, SIGKILL);
+        ::waitpid(pid, &status, 0);
+    }
+    EXPECT_EQ(done, pid) << "predecessor still running after handoff";
+    EXPECT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    for (int fd : fds) ::close(fd);
+    ::unlink(path.c_str());
+}
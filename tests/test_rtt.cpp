@@ -0,0 +1,159 @@
+
+#include <gtest/gtest.h>
+#include "udp/loopback.hpp"
+#include "udp/client.hpp"
+#include "udp/server.hpp"
+
+using namespace udp;
+
+static ServerConfig echo_server() {
+    ServerConfig cfg;
+    cfg.batch = 64;
+    cfg.metrics_port = 0;
+    cfg.verbose = false;
+    cfg.echo = true;
+    return cfg;
+}
+
+static ClientConfig rtt_client() {
+    ClientConfig cfg;
+    cfg.pps = 100000;
+    cfg.seconds = 1;
+    cfg.batch = 64;
+    cfg.rtt = true;
+    cfg.rtt_drain_ms = 500;
+    return cfg;
+}
+
+TEST(Rtt, CorrelatesEchoesAndAccountsLossOnBothLegs) {
+    LinkImpairment up, down;
+    up.loss = 0.05;
+    up.delay_ns = 300'000;
+    up.seed = 11;
+    down.loss = 0.05;
+    down.delay_ns = 200'000;
+    down.seed = 12;
+    auto p = make_loopback_pair(up, down, 1 << 16);
+    auto a_to_b = p.a_to_b, b_to_a = p.b_to_a;
+
+    UdpServer srv(std::move(p.b), echo_server());
+    srv.start();
+    UdpClient cli(std::move(p.a), rtt_client());
+    cli.start();
+    cli.join();
+    srv.stop();
+
+    const RttReport r = cli.rtt_report();
+    EXPECT_EQ(r.sent, a_to_b->sent());
+    EXPECT_EQ(r.received, r.sent - a_to_b->lost() - b_to_a->lost());
+    EXPECT_EQ(r.duplicates, 0u);
+    EXPECT_EQ(r.late, 0u);
+    EXPECT_NEAR(r.loss_ratio(), 1.0 - 0.95 * 0.95, 0.02);
+    EXPECT_GT(r.achieved_pps(), 0.0);
+
+    const auto& rtt = cli.stats().latency(LatencyStage::Rtt);
+    EXPECT_EQ(rtt.count(), r.received);
+    EXPECT_GE(rtt.percentile(0.5), up.delay_ns + down.delay_ns);
+}
+
+TEST(Rtt, DuplicateEchoesAreCountedOnce) {
+    LinkImpairment down;
+    down.duplicate = 0.1;
+    down.seed = 5;
+    auto p = make_loopback_pair({}, down, 1 << 16);
+    auto b_to_a = p.b_to_a;
+
+    UdpServer srv(std::move(p.b), echo_server());
+    srv.start();
+    ClientConfig ccfg = rtt_client();
+    ccfg.pps = 20000;
+    UdpClient cli(std::move(p.a), ccfg);
+    cli.start();
+    cli.join();
+    srv.stop();
+
+    const RttReport r = cli.rtt_report();
+    EXPECT_EQ(r.received, r.sent);
+    EXPECT_EQ(r.lost(), 0u);
+    EXPECT_GT(r.duplicates, 0u);
+    // A duplicate of the very last echo may still be in flight when draining ends.
+    EXPECT_LE(b_to_a->duplicated() - r.duplicates, 1u);
+    EXPECT_EQ(cli.stats().latency(LatencyStage::Rtt).count(), r.sent);
+}
+
+TEST(Rtt, EchoesLappedByTheRingAreLateNotLostOrMistimed) {
+    // A one-second return leg at 100k pps keeps more packets in flight than
+    // the 64k outstanding ring, so the oldest echoes find their slot rearmed.
+    LinkImpairment down;
+    down.delay_ns = 1'000'000'000;
+    auto p = make_loopback_pair({}, down, 1 << 18);
+
+    UdpServer srv(std::move(p.b), echo_server());
+    srv.start();
+    ClientConfig ccfg = rtt_client();
+    ccfg.rtt_drain_ms = 2000;
+    UdpClient cli(std::move(p.a), ccfg);
+    cli.start();
+    cli.join();
+    srv.stop();
+
+    const RttReport r = cli.rtt_report();
+    EXPECT_GT(r.late, 0u);
+    EXPECT_EQ(r.received + r.late, r.sent);
+    EXPECT_EQ(r.lost(), 0u);
+    EXPECT_EQ(r.duplicates, 0u);
+    // No echo may be timed against a newer packet's send stamp.
+    const auto& rtt = cli.stats().latency(LatencyStage::Rtt);
+    EXPECT_EQ(rtt.count(), r.received);
+    EXPECT_GE(rtt.percentile(0.0), down.delay_ns);
+}
+
+TEST(Rtt, DuplicatesOfLateEchoesAreNotCountedLateAgain) {
+    // Duplicated echoes on a return leg longer than the ring: each repeat,
+    // whether its original was timed or late, is a duplicate and nothing else.
+    LinkImpairment down;
+    down.delay_ns = 1'000'000'000;
+    down.duplicate = 0.1;
+    down.seed = 7;
+    auto p = make_loopback_pair({}, down, 1 << 18);
+    auto b_to_a = p.b_to_a;
+
+    UdpServer srv(std::move(p.b), echo_server());
+    srv.start();
+    ClientConfig ccfg = rtt_client();
+    ccfg.rtt_drain_ms = 2000;
+    UdpClient cli(std::move(p.a), ccfg);
+    cli.start();
+    cli.join();
+    srv.stop();
+
+    const RttReport r = cli.rtt_report();
+    EXPECT_GT(r.late, 0u);
+    EXPECT_EQ(r.received + r.late, r.sent);
+    EXPECT_EQ(r.lost(), 0u);
+    EXPECT_GT(r.duplicates, 0u);
+    // A duplicate of the very last echo may still be in flight when draining ends.
+    EXPECT_LE(b_to_a->duplicated() - r.duplicates, 1u);
+}
+
+TEST(Rtt, ClientQueueOverflowIsNotPathLoss) {
+    // Echoes pile up behind a 20 ms return delay in a 256-datagram queue; the
+    // overflow happens at the client's own socket, not on the path.
+    LinkImpairment down;
+    down.delay_ns = 20'000'000;
+    auto p = make_loopback_pair({}, down, 256);
+    auto a_to_b = p.a_to_b, b_to_a = p.b_to_a;
+
+    UdpServer srv(std::move(p.b), echo_server());
+    srv.start();
+    UdpClient cli(std::move(p.a), rtt_client());
+    cli.start();
+    cli.join();
+    srv.stop();
+
+    const RttReport r = cli.rtt_report();
+    EXPECT_GT(r.client_rx_dropped, 0u);
+    EXPECT_EQ(r.client_rx_dropped, b_to_a->overflowed());
+    // Only the outbound leg's overflow (at the server) is left as path loss.
+    EXPECT_EQ(r.lost(), a_to_b->overflowed());
+}
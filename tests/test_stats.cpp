@@ -24,3 +24,15 @@ TEST(Stats, Clients) {
     EXPECT_EQ(s.unique_clients(), 2u);
     EXPECT_NE(s.to_string().size(), 0u);
 }
+
+TEST(Stats, UniqueClientsStayBoundedAndCumulative) {
+    Stats s;
+    // A million ephemeral ports from a few hundred hosts, each seen twice.
+    for (int pass = 0; pass < 2; ++pass) {
+        for (uint32_t i = 0; i < 1'000'000; ++i) s.note_client(0x0a000000u + (i >> 12), static_cast<uint16_t>(i));
+    }
+    EXPECT_NEAR(static_cast<double>(s.unique_clients()), 1e6, 1e6 * 0.05);
+    // Unaffected by flow-table churn: active flows are reported separately.
+    s.flows().active.store(3);
+    EXPECT_NEAR(static_cast<double>(s.unique_clients()), 1e6, 1e6 * 0.05);
+}
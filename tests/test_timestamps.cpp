@@ -0,0 +1,123 @@
+
+#include <gtest/gtest.h>
+#include "udp/histogram.hpp"
+#include "udp/server.hpp"
+#include "udp/socket.hpp"
+#include "udp/common.hpp"
+#include <thread>
+
+using namespace udp;
+
+TEST(Histogram, IndexRoundTrip) {
+    for (uint64_t v : {0ull, 1ull, 7ull, 8ull, 15ull, 16ull, 1000ull, 123456789ull, ~0ull}) {
+        size_t idx = LatencyHistogram::index(v);
+        ASSERT_LT(idx, LatencyHistogram::kBuckets);
+        EXPECT_GE(LatencyHistogram::upper_bound(idx), v);
+        if (idx > 0) {
+            EXPECT_LT(LatencyHistogram::upper_bound(idx - 1), v);
+        }
+    }
+}
+
+TEST(Histogram, Percentiles) {
+    LatencyHistogram h;
+    EXPECT_EQ(h.percentile(0.5), 0u);
+    for (uint64_t v = 1; v <= 1000; ++v) h.record(v * 1000);
+    EXPECT_EQ(h.count(), 1000u);
+    EXPECT_EQ(h.sum(), 500500000u);
+    uint64_t p50 = h.percentile(0.5);
+    uint64_t p99 = h.percentile(0.99);
+    EXPECT_NEAR(static_cast<double>(p50), 500000.0, 500000.0 * 0.13);
+    EXPECT_NEAR(static_cast<double>(p99), 990000.0, 990000.0 * 0.13);
+    EXPECT_LE(p50, p99);
+    h.reset();
+    EXPECT_EQ(h.count(), 0u);
+}
+
+TEST(Histogram, WeightedRecordCountsEverySample) {
+    // One batch of 63 packets at 10us and one of 1 packet at 1ms: per packet,
+    // the median is 10us even though half the batches took 1ms.
+    LatencyHistogram h;
+    h.record(10'000, 63);
+    h.record(1'000'000, 1);
+    EXPECT_EQ(h.count(), 64u);
+    EXPECT_EQ(h.sum(), 63u * 10'000 + 1'000'000);
+    EXPECT_LT(h.percentile(0.5), 20'000u);
+    EXPECT_GE(h.percentile(1.0), 1'000'000u);
+}
+
+TEST(Timestamps, MockSocketDefaultsUnsupported) {
+    MockSocket s;
+    EXPECT_FALSE(s.enable_timestamps(true, true));
+    std::vector<TxTimestamp> out;
+    EXPECT_EQ(s.read_tx_timestamps(out), 0u);
+}
+
+TEST(Timestamps, LoopbackRxAndTx) {
+    UdpSocket rx(4);
+    rx.bind(0, false);
+    ASSERT_TRUE(rx.enable_timestamps(true, false));
+    SockAddr local;
+    socklen_t llen = sizeof(sockaddr_in6);
+    ASSERT_EQ(getsockname(rx.fd(), &local.sa, &llen), 0);
+
+    UdpSocket tx(4);
+    tx.connect("127.0.0.1", ntohs(local.v4.sin_port));
+    bool tx_ok = tx.enable_timestamps(false, true);
+
+    const uint64_t before = wall_ns();
+    std::vector<std::vector<uint8_t>> out(3, std::vector<uint8_t>(32, 1));
+    ASSERT_EQ(tx.send_batch(out, nullptr), 3);
+
+    std::vector<std::vector<uint8_t>> bufs(4, std::vector<uint8_t>(64));
+    std::vector<PacketMeta> meta;
+    ssize_t r = 0;
+    for (int i = 0; i < 100 && r == 0; ++i) {
+        r = rx.recv_batch(bufs, &meta);
+        if (r == 0) std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    ASSERT_GT(r, 0);
+    for (ssize_t i = 0; i < r; ++i) {
+        EXPECT_GE(meta[i].rx_ts_ns, before);
+        EXPECT_LE(meta[i].rx_ts_ns, wall_ns());
+    }
+
+    if (!tx_ok) GTEST_SKIP() << "TX timestamping unsupported";
+    std::vector<TxTimestamp> stamps;
+    for (int i = 0; i < 100 && stamps.size() < 3; ++i) {
+        tx.read_tx_timestamps(stamps);
+        if (stamps.size() < 3) std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    if (stamps.empty()) GTEST_SKIP() << "no TX timestamps delivered on this kernel";
+    EXPECT_EQ(stamps[0].id, 0u);
+    EXPECT_GE(stamps[0].ts_ns, before);
+}
+
+TEST(Timestamps, ServerSkipsKernelStagesWhenUnsupported) {
+    auto ms = std::make_unique<MockSocket>();
+    std::vector<uint8_t> pkt(64, 0);
+    auto* hdr = reinterpret_cast<PacketHeader*>(pkt.data());
+    const uint64_t t0 = wall_ns();
+    hdr->seq = 1; hdr->send_ts_ns = t0 - 50'000; hdr->magic = kMagic;
+    SockAddr peer;
+    ASSERT_TRUE(parse_address("127.0.0.1", 6000, peer));
+    ms->preload_recv(pkt, peer, t0);
+
+    ServerConfig cfg;
+    cfg.batch = 4;
+    cfg.metrics_port = 0;
+    cfg.verbose = false;
+    cfg.timestamps = true;
+    UdpServer srv(std::move(ms), cfg);
+    // MockSocket has no kernel timestamps, so the server turns the feature off
+    // and ignores the stamp in the metadata (see Loopback.ClientServerEndToEnd
+    // for the enabled path).
+    srv.start();
+    for (int i = 0; i < 100 && srv.stats().recv() < 1; ++i)
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    srv.stop();
+    EXPECT_EQ(srv.stats().recv(), 1u);
+    EXPECT_EQ(srv.stats().latency(LatencyStage::Queueing).count(), 0u);
+    EXPECT_EQ(srv.stats().latency(LatencyStage::Network).count(), 0u);
+    EXPECT_EQ(srv.stats().latency(LatencyStage::Processing).count(), 0u);
+}
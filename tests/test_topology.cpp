@@ -0,0 +1,143 @@
+
+#include <gtest/gtest.h>
+#include "udp/topology.hpp"
+#include "udp/server.hpp"
+#include "udp/config.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <sys/stat.h>
+
+using namespace udp;
+
+static void mkdirs(const std::string& path) {
+    for (size_t i = 1; i <= path.size(); ++i) {
+        if (i == path.size() || path[i] == '/') ::mkdir(path.substr(0, i).c_str(), 0755);
+    }
+}
+
+static void put(const std::string& path, const std::string& text) {
+    mkdirs(path.substr(0, path.rfind('/')));
+    std::ofstream(path) << text << "\n";
+}
+
+// Two sockets, two cores each, one NUMA node per socket; eth9 on node 1.
+// The temporary tree is removed when the holder goes out of scope.
+struct FakeTree {
+    FakeTree();
+    ~FakeTree() { std::filesystem::remove_all(root); }
+    std::string root;
+};
+
+FakeTree::FakeTree() {
+    char tmpl[] = "/tmp/udp_topoXXXXXX";
+    root = ::mkdtemp(tmpl);
+    put(root + "/sys/devices/system/cpu/online", "0-3");
+    for (int c = 0; c < 4; ++c) {
+        std::string t = root + "/sys/devices/system/cpu/cpu" + std::to_string(c) + "/topology/";
+        put(t + "core_id", std::to_string(c % 2));
+        put(t + "physical_package_id", std::to_string(c / 2));
+    }
+    put(root + "/sys/devices/system/node/node0/cpulist", "0-1");
+    put(root + "/sys/devices/system/node/node1/cpulist", "2-3");
+    put(root + "/sys/class/net/eth9/device/numa_node", "1");
+    put(root + "/sys/class/net/eth9/device/msi_irqs/40", "msix");
+    put(root + "/sys/class/net/eth9/device/msi_irqs/41", "msix");
+    put(root + "/proc/interrupts",
+        "           CPU0       CPU1\n"
+        "  40:        10          0   PCI-MSI 1-edge      eth9-TxRx-0\n"
+        "  41:         0         12   PCI-MSI 2-edge      eth9-TxRx-1\n"
+        "  50:         1          1   PCI-MSI 3-edge      nvme0q1\n"
+        "  60:         3          0   PCI-MSI 4-edge      eth90-TxRx-0");
+    put(root + "/proc/irq/40/smp_affinity_list", "2");
+    put(root + "/proc/irq/41/smp_affinity_list", "0-1");
+}
+
+TEST(Topology, ParsesCpuLists) {
+    EXPECT_EQ(Topology::parse_cpulist("0-3,8,10-11"), (std::vector<int>{0, 1, 2, 3, 8, 10, 11}));
+    EXPECT_EQ(Topology::parse_cpulist("5"), (std::vector<int>{5}));
+    EXPECT_TRUE(Topology::parse_cpulist("").empty());
+}
+
+TEST(Topology, DiscoversNodesFromSysfs) {
+    FakeTree tree;
+    const std::string& root = tree.root;
+    Topology t = Topology::discover(root + "/sys");
+    ASSERT_EQ(t.cpus().size(), 4u);
+    EXPECT_EQ(t.node_count(), 2);
+    EXPECT_EQ(t.node_of(1), 0);
+    EXPECT_EQ(t.node_of(3), 1);
+    EXPECT_EQ(t.node_of(9), -1);
+    EXPECT_EQ(t.cpus_on_node(1), (std::vector<int>{2, 3}));
+    EXPECT_EQ(t.cpus()[2].package, 1);
+    EXPECT_EQ(t.cpus()[3].core, 1);
+
+    // No node directory: everything is node 0.
+    Topology flat = Topology::discover(root + "/missing");
+    EXPECT_EQ(flat.node_count(), 1);
+}
+
+TEST(Topology, ReportsNicIrqAffinity) {
+    FakeTree tree;
+    const std::string& root = tree.root;
+    EXPECT_EQ(nic_numa_node("eth9", root + "/sys"), 1);
+    EXPECT_EQ(nic_numa_node("lo", root + "/sys"), -1);
+    auto irqs = nic_irqs("eth9", root + "/sys", root + "/proc");
+    ASSERT_EQ(irqs.size(), 2u);
+    EXPECT_EQ(irqs[0].irq, 40);
+    EXPECT_EQ(irqs[0].name, "eth9-TxRx-0");
+    EXPECT_EQ(irqs[0].cpus, (std::vector<int>{2}));
+    EXPECT_EQ(irqs[1].cpus, (std::vector<int>{0, 1}));
+
+    // Without msi_irqs the names decide: "eth9" must not pick up eth90's IRQ.
+    std::filesystem::remove_all(root + "/sys/class/net/eth9/device/msi_irqs");
+    irqs = nic_irqs("eth9", root + "/sys", root + "/proc");
+    ASSERT_EQ(irqs.size(), 2u);
+    EXPECT_EQ(irqs[0].irq, 40);
+    EXPECT_EQ(irqs[1].irq, 41);
+    irqs = nic_irqs("eth90", root + "/sys", root + "/proc");
+    ASSERT_EQ(irqs.size(), 1u);
+    EXPECT_EQ(irqs[0].irq, 60);
+}
+
+TEST(Topology, ServerPinsWorkersToAllowedCpus) {
+    ServerConfig cfg;
+    ASSERT_TRUE(apply_server_option(cfg, "pin-workers", ""));
+    ASSERT_TRUE(apply_server_option(cfg, "nic", "lo"));
+    EXPECT_EQ(cfg.nic, "lo");
+    cfg.metrics_port = 0;
+    cfg.verbose = false;
+    cfg.workers = 2;
+    UdpServer srv(std::make_unique<MockSocket>(), cfg);
+    srv.start();
+    std::vector<WorkerPlacement> places;
+    for (int i = 0; i < 200; ++i) {
+        places = srv.placement();
+        if (places.size() == 2 && places[0].pinned && places[1].pinned) break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    srv.stop();
+    ASSERT_EQ(places.size(), 2u);
+    auto allowed = allowed_cpus();
+    for (const auto& p : places) {
+        EXPECT_TRUE(p.pinned);
+        EXPECT_NE(std::find(allowed.begin(), allowed.end(), p.cpu), allowed.end());
+        EXPECT_EQ(p.node, srv.topology().node_of(p.cpu));
+    }
+}
+
+TEST(Topology, IrqReportFollowsVerbose) {
+    ServerConfig cfg;
+    cfg.nic = "lo";
+    cfg.metrics_port = 0;
+    cfg.verbose = false;
+    testing::internal::CaptureStdout();
+    { UdpServer srv(std::make_unique<MockSocket>(), cfg); }
+    EXPECT_EQ(testing::internal::GetCapturedStdout(), "");
+    cfg.verbose = true;
+    testing::internal::CaptureStdout();
+    { UdpServer srv(std::make_unique<MockSocket>(), cfg); }
+    EXPECT_NE(testing::internal::GetCapturedStdout().find("[server] NIC lo"), std::string::npos);
+}